@@ -0,0 +1,296 @@
+/*
+
+Copyright 2025 Marc Ketel
+SPDX-License-Identifier: Apache-2.0
+
+*/
+
+#include "colorlut.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SCREEN_GAMMA 2.2f
+
+static const ColorProfile builtin_profiles[COLOR_BUILTIN_PROFILES] = {
+    // Plain 5/6-bit to 8-bit scaling, as without calibration.
+    {
+        .name = "linear",
+        .gamma = {SCREEN_GAMMA, SCREEN_GAMMA, SCREEN_GAMMA},
+        .brightness = 1.0f,
+        .matrix = {1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f},
+    },
+    // Uncalibrated placeholder for the RevSpace banner: brighter mid tones
+    // and more saturated primaries, chosen by eye, not measured. The LEDs
+    // are clipped to white in ledbanner-compare.jpg, so no gamma or
+    // primaries can be read from it. Measure the banner and put the real
+    // values in a profile file.
+    {
+        .name = "ledbanner-uncalibrated",
+        .gamma = {1.9f, 2.0f, 1.8f},
+        .brightness = 1.0f,
+        .matrix = {1.08f, -0.05f, -0.03f, -0.04f, 1.06f, -0.02f, -0.02f, -0.06f, 1.08f},
+    },
+};
+
+static int parse_floats(const char *s, float *out, int count) {
+    int n = 0;
+    while (n < count) {
+        char *end = NULL;
+        float v = strtof(s, &end);
+        if (end == s) {
+            break;
+        }
+        out[n++] = v;
+        s = end;
+    }
+    return n;
+}
+
+// Profile file: one setting per line, '#' starts a comment.
+//   gamma 2.2 2.2 2.2      (or a single value for all channels)
+//   brightness 1.0
+//   matrix 1 0 0  0 1 0  0 0 1
+static bool load_profile_file(const char *path, ColorProfile *out) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "Colour profile %s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    *out = builtin_profiles[0];
+    snprintf(out->name, sizeof(out->name), "%s", path);
+
+    char line[256];
+    int line_no = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), f)) {
+        line_no++;
+        char *hash = strchr(line, '#');
+        if (hash) {
+            *hash = '\0';
+        }
+
+        char key[32];
+        int consumed = 0;
+        if (sscanf(line, "%31s%n", key, &consumed) != 1) {
+            continue; // blank or comment
+        }
+        const char *args = line + consumed;
+
+        float v[9];
+        int n = parse_floats(args, v, 9);
+        if (strcmp(key, "gamma") == 0 && (n == 1 || n == 3)) {
+            for (int c = 0; c < 3; ++c) {
+                out->gamma[c] = v[n == 1 ? 0 : c];
+            }
+        } else if (strcmp(key, "brightness") == 0 && n == 1) {
+            out->brightness = v[0];
+        } else if (strcmp(key, "matrix") == 0 && n == 9) {
+            memcpy(out->matrix, v, sizeof(out->matrix));
+        } else {
+            fprintf(stderr, "Colour profile %s:%d: expected gamma, brightness or matrix\n", path, line_no);
+            ok = false;
+        }
+    }
+    fclose(f);
+
+    for (int c = 0; ok && c < 3; ++c) {
+        if (out->gamma[c] <= 0.0f) {
+            fprintf(stderr, "Colour profile %s: gamma must be positive\n", path);
+            ok = false;
+        }
+    }
+    if (ok && out->brightness < 0.0f) {
+        fprintf(stderr, "Colour profile %s: brightness must not be negative\n", path);
+        ok = false;
+    }
+    return ok;
+}
+
+bool color_profile_load(const char *spec, ColorProfile *out) {
+    for (int i = 0; i < COLOR_BUILTIN_PROFILES; ++i) {
+        if (strcmp(spec, builtin_profiles[i].name) == 0) {
+            *out = builtin_profiles[i];
+            return true;
+        }
+    }
+    return load_profile_file(spec, out);
+}
+
+static uint8_t encode_channel(float linear) {
+    if (linear <= 0.0f) {
+        return 0;
+    }
+    if (linear >= 1.0f) {
+        return 255;
+    }
+    return (uint8_t)(SDL_powf(linear, 1.0f / SCREEN_GAMMA) * 255.0f + 0.5f);
+}
+
+// All the per-pixel arithmetic lives here, once per RGB565 value.
+static void build_table(uint32_t *table, const ColorProfile *p) {
+    float r_lin[32];
+    float g_lin[64];
+    float b_lin[32];
+    for (int i = 0; i < 32; ++i) {
+        r_lin[i] = SDL_powf((float)i / 31.0f, p->gamma[0]) * p->brightness;
+        b_lin[i] = SDL_powf((float)i / 31.0f, p->gamma[2]) * p->brightness;
+    }
+    for (int i = 0; i < 64; ++i) {
+        g_lin[i] = SDL_powf((float)i / 63.0f, p->gamma[1]) * p->brightness;
+    }
+
+    const float *m = p->matrix;
+    for (uint32_t raw = 0; raw < COLOR_LUT_ENTRIES; ++raw) {
+        const float r = r_lin[(raw >> 11) & 0x1F];
+        const float g = g_lin[(raw >> 5) & 0x3F];
+        const float b = b_lin[raw & 0x1F];
+
+        const uint8_t out_r = encode_channel(m[0] * r + m[1] * g + m[2] * b);
+        const uint8_t out_g = encode_channel(m[3] * r + m[4] * g + m[5] * b);
+        const uint8_t out_b = encode_channel(m[6] * r + m[7] * g + m[8] * b);
+        table[raw] = 0xFF000000u | ((uint32_t)out_r << 16) | ((uint32_t)out_g << 8) | out_b;
+    }
+}
+
+static int SDLCALL builder_thread(void *data) {
+    ColorLut *lut = data;
+
+    for (;;) {
+        SDL_WaitSemaphore(lut->wake);
+        if (SDL_GetAtomicInt(&lut->quit)) {
+            break;
+        }
+        // back is still waiting to be swapped in; the swap wakes us again.
+        if (SDL_GetAtomicInt(&lut->ready)) {
+            continue;
+        }
+
+        SDL_LockMutex(lut->lock);
+        int idx = lut->pending;
+        lut->pending = -1;
+        SDL_UnlockMutex(lut->lock);
+        if (idx < 0) {
+            continue;
+        }
+
+        ColorProfile profile;
+        if (!color_profile_load(lut->specs[idx], &profile)) {
+            fprintf(stderr, "Warning: keeping the current colour profile\n");
+            continue;
+        }
+
+        Uint64 t0 = SDL_GetTicksNS();
+        build_table(lut->back, &profile);
+        printf("Colour profile: %s (table built in %.1f ms)\n", profile.name, (SDL_GetTicksNS() - t0) / 1e6);
+        fflush(stdout);
+
+        SDL_SetAtomicInt(&lut->ready, 1);
+    }
+    return 0;
+}
+
+bool color_lut_init(ColorLut *lut, const AppConfig *config) {
+    memset(lut, 0, sizeof(*lut));
+    lut->pending = -1;
+
+    for (int i = 0; i < config->color_profile_count; ++i) {
+        lut->specs[lut->spec_count++] = config->color_profiles[i];
+    }
+    for (int i = 0; i < COLOR_BUILTIN_PROFILES; ++i) {
+        bool listed = false;
+        for (int j = 0; j < lut->spec_count; ++j) {
+            listed = listed || strcmp(lut->specs[j], builtin_profiles[i].name) == 0;
+        }
+        if (!listed) {
+            lut->specs[lut->spec_count++] = builtin_profiles[i].name;
+        }
+    }
+
+    lut->front = SDL_malloc(COLOR_LUT_ENTRIES * sizeof(uint32_t));
+    lut->back = SDL_malloc(COLOR_LUT_ENTRIES * sizeof(uint32_t));
+    if (!lut->front || !lut->back) {
+        fprintf(stderr, "Out of memory for the colour table\n");
+        color_lut_close(lut);
+        return false;
+    }
+
+    ColorProfile profile;
+    if (!color_profile_load(lut->specs[0], &profile)) {
+        fprintf(stderr, "Warning: using the linear colour profile\n");
+        profile = builtin_profiles[0];
+    }
+    build_table(lut->front, &profile);
+    if (config->color_profile_count > 0) {
+        printf("Colour profile: %s\n", profile.name);
+    }
+    return true;
+}
+
+void color_lut_next(ColorLut *lut) {
+    if (!lut->front || lut->spec_count < 2) {
+        return;
+    }
+
+    if (!lut->thread) {
+        if (!lut->wake) {
+            lut->wake = SDL_CreateSemaphore(0);
+        }
+        if (!lut->lock) {
+            lut->lock = SDL_CreateMutex();
+        }
+        if (lut->wake && lut->lock) {
+            lut->thread = SDL_CreateThread(builder_thread, "colorlut", lut);
+        }
+        if (!lut->thread) {
+            fprintf(stderr, "Warning: cannot start the colour table thread: %s\n", SDL_GetError());
+            return;
+        }
+    }
+
+    // Repeated presses while a table is being built only keep the last one.
+    lut->current = (lut->current + 1) % lut->spec_count;
+    SDL_LockMutex(lut->lock);
+    lut->pending = lut->current;
+    SDL_UnlockMutex(lut->lock);
+    SDL_SignalSemaphore(lut->wake);
+}
+
+bool color_lut_ready(ColorLut *lut) {
+    return lut->thread && SDL_GetAtomicInt(&lut->ready) != 0;
+}
+
+bool color_lut_swap(ColorLut *lut) {
+    if (!color_lut_ready(lut)) {
+        return false;
+    }
+
+    uint32_t *tmp = lut->front;
+    lut->front = lut->back;
+    lut->back = tmp;
+    SDL_SetAtomicInt(&lut->ready, 0);
+
+    // A request that came in while back was busy can be built now.
+    SDL_SignalSemaphore(lut->wake);
+    return true;
+}
+
+void color_lut_close(ColorLut *lut) {
+    if (lut->thread) {
+        SDL_SetAtomicInt(&lut->quit, 1);
+        SDL_SignalSemaphore(lut->wake);
+        SDL_WaitThread(lut->thread, NULL);
+    }
+    if (lut->wake) {
+        SDL_DestroySemaphore(lut->wake);
+    }
+    if (lut->lock) {
+        SDL_DestroyMutex(lut->lock);
+    }
+    SDL_free(lut->front);
+    SDL_free(lut->back);
+    memset(lut, 0, sizeof(*lut));
+}
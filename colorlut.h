@@ -0,0 +1,72 @@
+/*
+
+Copyright 2025 Marc Ketel
+SPDX-License-Identifier: Apache-2.0
+
+*/
+
+/*
+ * Colour calibration lookup table.
+ *
+ * A calibration profile (gamma per channel, brightness, 3x3 colour matrix)
+ * is baked into a 65536-entry table that maps every RGB565 value straight
+ * to an ARGB8888 pixel, so decoding a frame is one table load per LED.
+ *
+ * Profiles are applied in linear light: each channel is raised to its
+ * gamma, mixed by the matrix, scaled by brightness and encoded for a
+ * gamma 2.2 screen. The built-in "linear" profile (gamma 2.2, identity)
+ * reproduces the plain 5/6-bit to 8-bit scaling.
+ *
+ * Switching profiles builds the new table on a helper thread into a back
+ * buffer; the render thread swaps it in with color_lut_swap(), so it never
+ * waits for a rebuild.
+ */
+
+#ifndef COLORLUT_H
+#define COLORLUT_H
+
+#include "config.h"
+
+#include <SDL3/SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define COLOR_LUT_ENTRIES      65536
+#define COLOR_BUILTIN_PROFILES 2
+
+typedef struct ColorProfile {
+    char name[64];
+    float gamma[3]; // R, G, B: source value to linear light
+    float brightness;
+    float matrix[9]; // row-major, applied to linear (R, G, B)
+} ColorProfile;
+
+typedef struct ColorLut {
+    uint32_t *front;     // table in use, read by the render thread only
+    uint32_t *back;      // built by the helper thread while ready is 0
+    SDL_AtomicInt ready; // back holds a finished table to swap in
+
+    // Profiles to cycle through: the configured ones, then the built-ins.
+    const char *specs[COLOR_MAX_PROFILES + COLOR_BUILTIN_PROFILES];
+    int spec_count;
+    int current; // index into specs of the last requested profile
+
+    SDL_Thread *thread; // started on the first profile switch
+    SDL_Semaphore *wake;
+    SDL_Mutex *lock;
+    int pending; // index into specs to build next, -1 = none; under lock
+    SDL_AtomicInt quit;
+} ColorLut;
+
+// Resolves a built-in profile name or loads a profile file.
+bool color_profile_load(const char *spec, ColorProfile *out);
+
+// Builds the table for the first configured profile (or "linear") on the
+// calling thread.
+bool color_lut_init(ColorLut *lut, const AppConfig *config);
+void color_lut_next(ColorLut *lut);  // request the next profile, built in the background
+bool color_lut_ready(ColorLut *lut); // a new table is waiting for color_lut_swap()
+bool color_lut_swap(ColorLut *lut);  // render thread; true if front changed
+void color_lut_close(ColorLut *lut);
+
+#endif // COLORLUT_H
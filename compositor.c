@@ -0,0 +1,382 @@
+/*
+
+Copyright 2025 Marc Ketel
+SPDX-License-Identifier: Apache-2.0
+
+*/
+
+#include "compositor.h"
+#include "multicast.h"
+#include "rgb565.h"
+#include "timeutil.h"
+
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#define PIXELS (WIDTH * HEIGHT)
+
+// Per channel: (src * alpha + dst * (256 - alpha) + 128) >> 8. The largest
+// product, 63 * 256, fits in 16 bits, so the SIMD versions can stay in
+// 16-bit lanes.
+static inline uint16_t blend_pixel(uint16_t s, uint16_t d, unsigned alpha) {
+    const unsigned inv = 256 - alpha;
+    const unsigned r = ((s >> 11) * alpha + (d >> 11) * inv + 128) >> 8;
+    const unsigned g = (((s >> 5) & 0x3F) * alpha + ((d >> 5) & 0x3F) * inv + 128) >> 8;
+    const unsigned b = ((s & 0x1F) * alpha + (d & 0x1F) * inv + 128) >> 8;
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+#if defined(__SSE2__)
+static inline __m128i bswap16_sse2(__m128i v) {
+    return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+static inline __m128i blend_channel_sse2(__m128i s, __m128i d, __m128i alpha, __m128i inv) {
+    const __m128i sum = _mm_add_epi16(_mm_mullo_epi16(s, alpha), _mm_mullo_epi16(d, inv));
+    return _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(128)), 8);
+}
+#endif
+
+// Blends frame src over frame dst in place. Pixels of src equal to key
+// (if keyed) leave dst as it is.
+static void blend_layer(unsigned char *dst, const unsigned char *src, bool keyed, uint16_t key, unsigned alpha) {
+    int i = 0;
+#if defined(__SSE2__)
+    const __m128i va = _mm_set1_epi16((short)alpha);
+    const __m128i vinv = _mm_set1_epi16((short)(256 - alpha));
+    const __m128i mask6 = _mm_set1_epi16(0x3F);
+    const __m128i mask5 = _mm_set1_epi16(0x1F);
+    const __m128i vkey = _mm_set1_epi16((short)key);
+    for (; i + 8 <= PIXELS; i += 8) {
+        const __m128i s = bswap16_sse2(_mm_loadu_si128((const __m128i *)(src + i * 2)));
+        const __m128i d = bswap16_sse2(_mm_loadu_si128((const __m128i *)(dst + i * 2)));
+
+        const __m128i r = blend_channel_sse2(_mm_srli_epi16(s, 11), _mm_srli_epi16(d, 11), va, vinv);
+        const __m128i g = blend_channel_sse2(
+            _mm_and_si128(_mm_srli_epi16(s, 5), mask6), _mm_and_si128(_mm_srli_epi16(d, 5), mask6), va, vinv);
+        const __m128i b = blend_channel_sse2(_mm_and_si128(s, mask5), _mm_and_si128(d, mask5), va, vinv);
+        __m128i out = _mm_or_si128(_mm_or_si128(_mm_slli_epi16(r, 11), _mm_slli_epi16(g, 5)), b);
+
+        if (keyed) {
+            const __m128i transparent = _mm_cmpeq_epi16(s, vkey);
+            out = _mm_or_si128(_mm_and_si128(transparent, d), _mm_andnot_si128(transparent, out));
+        }
+        _mm_storeu_si128((__m128i *)(dst + i * 2), bswap16_sse2(out));
+    }
+#elif defined(__ARM_NEON)
+    const uint16x8_t va = vdupq_n_u16((uint16_t)alpha);
+    const uint16x8_t vinv = vdupq_n_u16((uint16_t)(256 - alpha));
+    const uint16x8_t round = vdupq_n_u16(128);
+    const uint16x8_t mask6 = vdupq_n_u16(0x3F);
+    const uint16x8_t mask5 = vdupq_n_u16(0x1F);
+    const uint16x8_t vkey = vdupq_n_u16(key);
+    for (; i + 8 <= PIXELS; i += 8) {
+        const uint16x8_t s = vreinterpretq_u16_u8(vrev16q_u8(vld1q_u8(src + i * 2)));
+        const uint16x8_t d = vreinterpretq_u16_u8(vrev16q_u8(vld1q_u8(dst + i * 2)));
+
+        const uint16x8_t r = vshrq_n_u16(
+            vaddq_u16(vmlaq_u16(vmulq_u16(vshrq_n_u16(s, 11), va), vshrq_n_u16(d, 11), vinv), round), 8);
+        const uint16x8_t g = vshrq_n_u16(vaddq_u16(vmlaq_u16(vmulq_u16(vandq_u16(vshrq_n_u16(s, 5), mask6), va),
+                                                             vandq_u16(vshrq_n_u16(d, 5), mask6),
+                                                             vinv),
+                                                   round),
+                                         8);
+        const uint16x8_t b =
+            vshrq_n_u16(vaddq_u16(vmlaq_u16(vmulq_u16(vandq_u16(s, mask5), va), vandq_u16(d, mask5), vinv), round), 8);
+        uint16x8_t out = vorrq_u16(vorrq_u16(vshlq_n_u16(r, 11), vshlq_n_u16(g, 5)), b);
+
+        if (keyed) {
+            out = vbslq_u16(vceqq_u16(s, vkey), d, out);
+        }
+        vst1q_u8(dst + i * 2, vrev16q_u8(vreinterpretq_u8_u16(out)));
+    }
+#endif
+    for (int o = i * 2; o < MC_EXPECTED_SIZE; o += 2) {
+        const uint16_t s = rgb565_at(src + o);
+        if (keyed && s == key) {
+            continue;
+        }
+        rgb565_put(dst + o, blend_pixel(s, rgb565_at(dst + o), alpha));
+    }
+}
+
+static bool parse_uint(const char *s, int base, long max, long *out) {
+    char *end = NULL;
+    long v = strtol(s, &end, base);
+    if (!end || end == s || *end != '\0' || v < 0 || v > max) {
+        return false;
+    }
+    *out = v;
+    return true;
+}
+
+// FROM[,key=RGB565][,alpha=N][,timeout=MS]. FROM is a sender address, or a
+// multicast GROUP[:PORT][@IFACE] that gets its own socket.
+static bool parse_layer(Layer *layer, const AppConfig *config, FramePool *pool, const char *spec) {
+    char buf[96];
+    if (strlen(spec) >= sizeof(buf)) {
+        fprintf(stderr, "Invalid layer: %s (too long)\n", spec);
+        return false;
+    }
+    snprintf(buf, sizeof(buf), "%s", spec);
+
+    layer->alpha = 256;
+    layer->timeout_ns = (uint64_t)LAYER_DEFAULT_TIMEOUT_MS * 1000000ULL;
+    layer->sock = -1;
+
+    char *opts = strchr(buf, ',');
+    if (opts) {
+        *opts++ = '\0';
+    }
+    for (char *opt = opts; opt && *opt;) {
+        char *next = strchr(opt, ',');
+        if (next) {
+            *next++ = '\0';
+        }
+        long v = 0;
+        if (strncmp(opt, "key=", 4) == 0 && parse_uint(opt + 4, 16, 0xFFFF, &v)) {
+            layer->keyed = true;
+            layer->key = (uint16_t)v;
+        } else if (strncmp(opt, "alpha=", 6) == 0 && parse_uint(opt + 6, 10, 255, &v)) {
+            // 255 means opaque; stretch to 0-256 so it blends as a plain copy.
+            layer->alpha = (uint16_t)(v + (v >> 7));
+        } else if (strncmp(opt, "timeout=", 8) == 0 && parse_uint(opt + 8, 10, 3600000, &v)) {
+            layer->timeout_ns = (uint64_t)v * 1000000ULL;
+        } else {
+            fprintf(stderr, "Invalid layer option in %s: %s (expected key=RGB565, alpha=0-255 or timeout=MS)\n", spec, opt);
+            return false;
+        }
+        opt = next;
+    }
+
+    snprintf(layer->label, sizeof(layer->label), "%s", buf);
+
+    // A unicast address is a sender on the main stream, anything else a group.
+    char host[sizeof(buf)];
+    snprintf(host, sizeof(host), "%s", buf);
+    host[strcspn(host, ":@")] = '\0';
+    struct in_addr addr;
+    if (inet_pton(AF_INET, host, &addr) != 1) {
+        fprintf(stderr, "Invalid layer: %s (expected a sender address or GROUP[:PORT][@IFACE])\n", spec);
+        return false;
+    }
+    if (!IN_MULTICAST(ntohl(addr.s_addr))) {
+        if (strcmp(host, buf) != 0) {
+            fprintf(stderr, "Invalid layer: %s (a sender layer takes no port or interface)\n", spec);
+            return false;
+        }
+        layer->by_sender = true;
+        layer->sender = addr;
+        return true;
+    }
+
+    // A group that fails to set up only loses this layer.
+    layer->sock = setup_multicast_path(config, buf);
+    if (layer->sock < 0) {
+        fprintf(stderr, "Warning: layer %s setup failed, continuing without it\n", spec);
+    } else {
+        receiver_init(&layer->rx, config, pool, layer->sock);
+    }
+    return true;
+}
+
+bool compositor_init(Compositor *c, const AppConfig *config, FramePool *pool) {
+    memset(c, 0, sizeof(*c));
+    c->pool = pool;
+    c->out = FRAME_NONE;
+    for (int i = 0; i < COMPOSITOR_LAYERS; ++i) {
+        c->layers[i].frame = FRAME_NONE;
+    }
+    if (config->layer_count == 0) {
+        return true;
+    }
+
+    Layer *base = &c->layers[0];
+    snprintf(base->label, sizeof(base->label), "main stream");
+    base->sock = -1;
+    base->alpha = 256;
+    c->layer_count = 1;
+
+    for (int i = 0; i < config->layer_count && i < LAYER_MAX_OVERLAYS; ++i) {
+        if (!parse_layer(&c->layers[c->layer_count], config, pool, config->layers[i])) {
+            compositor_close(c);
+            return false;
+        }
+        c->layer_count++;
+    }
+
+    printf("Compositing %d layer%s over the main stream\n", c->layer_count - 1, c->layer_count == 2 ? "" : "s");
+    return true;
+}
+
+bool compositor_active(const Compositor *c) {
+    return c->layer_count > 0;
+}
+
+static void layer_update(Compositor *c, Layer *layer, const unsigned char *data, int pool_slot, uint64_t rx_ns) {
+    layer->received++;
+    layer->last_ns = rx_ns;
+
+    // Senders repeat unchanged frames; those cost a compare, not a blend.
+    if (layer->frame == FRAME_NONE || memcmp(frame_pool_data(c->pool, layer->frame), data, MC_EXPECTED_SIZE) != 0) {
+        // Shares the slot the frame was received in. With the pool
+        // exhausted the layer keeps its previous frame.
+        const int kept = frame_pool_keep(c->pool, pool_slot, data, MC_EXPECTED_SIZE);
+        if (kept != FRAME_NONE) {
+            frame_pool_unref(c->pool, layer->frame);
+            layer->frame = kept;
+            layer->changes++;
+            c->dirty = true;
+        }
+    }
+
+    if (!layer->live && layer->frame != FRAME_NONE) {
+        layer->live = true;
+        c->dirty = true;
+        if (layer != &c->layers[0]) {
+            printf("Layer %s: live\n", layer->label);
+            fflush(stdout);
+        }
+    }
+}
+
+void compositor_submit(Compositor *c, const ReceivedFrame *frame, uint64_t rx_ns) {
+    Layer *layer = &c->layers[0];
+    for (int i = 1; i < c->layer_count; ++i) {
+        if (c->layers[i].by_sender && c->layers[i].sender.s_addr == frame->src.sin_addr.s_addr) {
+            layer = &c->layers[i];
+            break;
+        }
+    }
+    layer_update(c, layer, frame->data, frame->pool_slot, rx_ns);
+}
+
+void compositor_poll(Compositor *c, uint64_t now_ns) {
+    for (int i = 1; i < c->layer_count; ++i) {
+        Layer *layer = &c->layers[i];
+
+        if (layer->sock >= 0) {
+            ReceivedFrame frame;
+            while (receiver_poll(&layer->rx, &frame)) {
+                if (frame.len == MC_EXPECTED_SIZE) {
+                    layer_update(c, layer, frame.data, frame.pool_slot, frame.have_rx_ts ? timespec_to_ns(&frame.rx_ts) : now_ns);
+                }
+                receiver_release(&layer->rx, &frame);
+            }
+        }
+
+        if (layer->live && layer->timeout_ns > 0 && now_ns > layer->last_ns + layer->timeout_ns) {
+            layer->live = false;
+            layer->expired++;
+            c->dirty = true;
+            printf("Layer %s: no frames for %llu ms, hidden\n",
+                   layer->label,
+                   (unsigned long long)(layer->timeout_ns / 1000000ULL));
+            fflush(stdout);
+        }
+    }
+}
+
+static bool layer_visible(const Layer *layer) {
+    return layer->live && layer->alpha > 0;
+}
+
+int compositor_compose(Compositor *c) {
+    if (!c->dirty) {
+        return FRAME_NONE;
+    }
+
+    // Everything below the topmost opaque layer is hidden: start there,
+    // or from black.
+    int base = c->layers[0].live ? 0 : -1;
+    int blended = 0;
+    for (int i = 1; i < c->layer_count; ++i) {
+        const Layer *layer = &c->layers[i];
+        if (!layer_visible(layer)) {
+            continue;
+        }
+        if (!layer->keyed && layer->alpha == 256) {
+            base = i;
+            blended = 0;
+        } else {
+            blended++;
+        }
+    }
+
+    int out;
+    if (base >= 0 && blended == 0) {
+        // Nothing on top: the output is that layer's frame, shared.
+        out = c->layers[base].frame;
+        frame_pool_ref(c->pool, out);
+        c->shared++;
+    } else {
+        out = frame_pool_acquire(c->pool);
+        if (out == FRAME_NONE) {
+            return FRAME_NONE; // still dirty, retried next time round
+        }
+        unsigned char *dst = frame_pool_data(c->pool, out);
+        if (base >= 0) {
+            memcpy(dst, frame_pool_data(c->pool, c->layers[base].frame), MC_EXPECTED_SIZE);
+        } else {
+            memset(dst, 0, MC_EXPECTED_SIZE);
+        }
+        for (int i = base < 1 ? 1 : base + 1; i < c->layer_count; ++i) {
+            const Layer *layer = &c->layers[i];
+            if (layer_visible(layer)) {
+                blend_layer(dst, frame_pool_data(c->pool, layer->frame), layer->keyed, layer->key, layer->alpha);
+            }
+        }
+    }
+
+    frame_pool_unref(c->pool, c->out);
+    c->out = out;
+    c->dirty = false;
+    c->compositions++;
+    return out;
+}
+
+int compositor_output(const Compositor *c) {
+    return c->out;
+}
+
+void print_compositor_summary(const Compositor *c) {
+    if (!compositor_active(c)) {
+        return;
+    }
+
+    printf("Compositor summary: %lu compositions, %lu of them one layer's frame as is\n", c->compositions, c->shared);
+    for (int i = 0; i < c->layer_count; ++i) {
+        const Layer *layer = &c->layers[i];
+        printf("  layer %d (%s)%s: %lu frames, %lu changes, %lu timeouts\n",
+               i,
+               layer->label,
+               !layer->by_sender && i > 0 && layer->sock < 0 ? " [setup failed]" : "",
+               layer->received,
+               layer->changes,
+               layer->expired);
+    }
+    fflush(stdout);
+}
+
+void compositor_close(Compositor *c) {
+    for (int i = 0; i < c->layer_count; ++i) {
+        if (i > 0 && c->layers[i].sock >= 0) {
+            receiver_close(&c->layers[i].rx);
+            close(c->layers[i].sock);
+            c->layers[i].sock = -1;
+        }
+        frame_pool_unref(c->pool, c->layers[i].frame);
+        c->layers[i].frame = FRAME_NONE;
+    }
+    frame_pool_unref(c->pool, c->out);
+    c->out = FRAME_NONE;
+}
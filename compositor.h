@@ -0,0 +1,90 @@
+/*
+
+Copyright 2025 Marc Ketel
+SPDX-License-Identifier: Apache-2.0
+
+*/
+
+/*
+ * Layer compositor for several senders sharing the banner.
+ *
+ * Layer 0 is the main stream: whatever arrives on the normal receive
+ * path(s) from a sender no overlay claims. Each --layer adds an overlay
+ * on top, in the order given, fed either by one sender on the main
+ * group(s) or by its own multicast group. Every layer keeps the latest
+ * frame it received, as a reference to the frame pool slot it arrived in.
+ *
+ * Overlays are blended over the layers below with a constant alpha, and
+ * pixels equal to the layer's colour key are transparent. The blend runs
+ * on RGB565 directly, eight pixels at a time where SIMD is available, and
+ * only when a layer's content changed or a layer appeared or expired. An
+ * overlay that has sent nothing for its timeout disappears.
+ */
+
+#ifndef COMPOSITOR_H
+#define COMPOSITOR_H
+
+#include "config.h"
+#include "framepool.h"
+#include "receiver.h"
+
+#include <netinet/in.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define COMPOSITOR_LAYERS (LAYER_MAX_OVERLAYS + 1)
+
+typedef struct Layer {
+    char label[96];
+
+    // Where frames come from: a sender on the main receive path(s), or
+    // this layer's own multicast socket.
+    bool by_sender;
+    struct in_addr sender;
+    int sock; // -1 unless fed by its own group
+    Receiver rx;
+
+    bool keyed;
+    uint16_t key;        // transparent RGB565 value, if keyed
+    uint16_t alpha;      // 0-256, 256 = opaque
+    uint64_t timeout_ns; // 0 = never expires
+
+    int frame; // pool slot of the latest frame, FRAME_NONE before the first
+    bool live;
+    uint64_t last_ns; // receive time of the latest frame
+
+    unsigned long received;
+    unsigned long changes;
+    unsigned long expired;
+} Layer;
+
+typedef struct Compositor {
+    FramePool *pool;
+    Layer layers[COMPOSITOR_LAYERS]; // [0] is the main stream, then bottom to top
+    int layer_count;                 // 0 = no overlays configured, compositing off
+    bool dirty;                      // out needs recomposing
+    int out;                         // pool slot of the last composition, FRAME_NONE = none
+    unsigned long compositions;
+    unsigned long shared;            // compositions that were one layer's frame as is
+} Compositor;
+
+// False on an invalid --layer spec. With no --layer the compositor stays
+// inactive and frames go straight to the display as before.
+bool compositor_init(Compositor *c, const AppConfig *config, FramePool *pool);
+bool compositor_active(const Compositor *c);
+
+// A frame from the main receive path(s), routed by sender.
+void compositor_submit(Compositor *c, const ReceivedFrame *frame, uint64_t rx_ns);
+// Receives on the overlays' own groups and expires stale layers.
+void compositor_poll(Compositor *c, uint64_t now_ns);
+// Pool slot of the composited frame if anything changed since the last
+// call, else FRAME_NONE. The compositor keeps its reference until the next
+// composition; take another to keep the frame longer.
+int compositor_compose(Compositor *c);
+// Pool slot of the last composition, FRAME_NONE before the first.
+int compositor_output(const Compositor *c);
+
+void print_compositor_summary(const Compositor *c);
+void compositor_close(Compositor *c);
+
+#endif // COMPOSITOR_H
@@ -8,6 +8,8 @@ SPDX-License-Identifier: Apache-2.0
 #ifndef CONFIG_H
 #define CONFIG_H
 
+#include <stdbool.h>
+
 #define WIDTH  80
 #define HEIGHT 8
 
@@ -16,6 +18,42 @@ SPDX-License-Identifier: Apache-2.0
 #define MC_GROUP         "239.0.0.1"
 #define MC_PORT          1565
 #define MC_EXPECTED_SIZE (WIDTH * HEIGHT * 2)
+#define MC_BUF_SIZE      2048
+#define MC_MAX_SOURCES   8 // source-specific joins per receiver
+#define MC_MAX_PATHS     4 // redundant receive paths for the hitless merge
+
+#define MERGE_WINDOW_DEFAULT_MS 100
+
+#define LAYER_MAX_OVERLAYS       8 // --layer sources composited over the main stream
+#define LAYER_DEFAULT_TIMEOUT_MS 3000
+
+#define COLOR_MAX_PROFILES 8
+
+#define REMAP_MAX_WIDTH      256 // largest matrix the stream can be remapped to
+#define REMAP_MAX_HEIGHT     64
+#define REMAP_MAX_FRAME_SIZE (REMAP_MAX_WIDTH * REMAP_MAX_HEIGHT * 2)
+
+#define HISTORY_DEFAULT_MINUTES 0 // rewinding is opt-in, the arena is allocated up front
+#define HISTORY_DEFAULT_MB      16
+
+#define BUSY_POLL_DEFAULT_USEC  50
+#define SCHED_FIFO_DEFAULT_PRIO 50
+
+typedef enum RenderPath {
+    RENDER_PATH_AUTO,     // surface path when SDL only offers its software renderer
+    RENDER_PATH_RENDERER, // SDL_Renderer, one filled rect per LED
+    RENDER_PATH_SURFACE,  // upscale straight into the window surface, no SDL_Renderer
+} RenderPath;
+
+typedef enum RemapFilter {
+    REMAP_FILTER_NEAREST, // one source pixel per output pixel
+    REMAP_FILTER_BOX,     // area-weighted average of the covered source pixels
+} RemapFilter;
+
+typedef enum RecvBackend {
+    RECV_BACKEND_SOCKET, // select() + recv() per datagram
+    RECV_BACKEND_URING,  // io_uring multishot recvmsg, falls back to socket
+} RecvBackend;
 
 typedef struct AppConfig {
     const char *title;
@@ -24,16 +62,56 @@ typedef struct AppConfig {
     int scale;
     const char *mc_group;
     int mc_port;
+    const char *mc_sources[MC_MAX_SOURCES]; // allowed senders, none = any source
+    int mc_source_count;
+    const char *mc_iface; // interface name or index to join on, NULL = kernel's choice
+    const char *mc_paths[MC_MAX_PATHS]; // redundant GROUP[:PORT][@IFACE] paths, none = just mc_group
+    int mc_path_count;
+    int merge_window_ms; // how long a frame's copies are matched across paths
+    const char *layers[LAYER_MAX_OVERLAYS]; // overlay layer specs, bottom to top, none = no compositing
+    int layer_count;
+    RecvBackend recv_backend;
+    bool busy_poll;       // spin on the socket instead of select() + SDL_Delay(10)
+    int busy_poll_usec;   // SO_BUSY_POLL budget for busy_poll
+    int cpu;              // pin the receive loop to this CPU, -1 = no pinning
+    int rt_priority;      // SCHED_FIFO priority for the receive loop, 0 = normal scheduling
+    bool lock_memory;     // mlockall() current and future pages
+    bool huge_pages;      // frame pool on explicit huge pages
+    const char *shm_name; // publish frames to this /dev/shm frame bus, NULL = off
+    int shm_history;      // frames of history kept on the frame bus
+    int history_minutes;  // rewind history length, 0 = off
+    int history_mb;       // rewind history arena size
+    int remap_width;       // target matrix, 0 = the stream's own 80x8, no remapping
+    int remap_height;
+    RemapFilter remap_filter;
+    bool remap_serpentine; // headless outputs in serpentine pixel order
+    bool governor;         // degrade gracefully under overload
+    int window_width;  // initial window size, 0 = width * scale
+    int window_height; // initial window size, 0 = height * scale
+    RenderPath render_path;
+    const char *render_driver; // SDL render driver name, NULL = SDL's choice
+    const char *color_profiles[COLOR_MAX_PROFILES]; // built-in names or profile files, first one active
+    int color_profile_count;
 } AppConfig;
 
-#define DEFAULT_APPCONFIG          \
-    {                              \
-        .title = "80x8 LedBanner", \
-        .width = WIDTH,            \
-        .height = HEIGHT,          \
-        .scale = 8,                \
-        .mc_group = MC_GROUP,      \
-        .mc_port = MC_PORT,        \
+#define DEFAULT_APPCONFIG                           \
+    {                                               \
+        .title = "80x8 LedBanner",                  \
+        .width = WIDTH,                             \
+        .height = HEIGHT,                           \
+        .scale = 8,                                 \
+        .mc_group = MC_GROUP,                       \
+        .mc_port = MC_PORT,                         \
+        .merge_window_ms = MERGE_WINDOW_DEFAULT_MS, \
+        .recv_backend = RECV_BACKEND_SOCKET,        \
+        .busy_poll_usec = BUSY_POLL_DEFAULT_USEC,   \
+        .cpu = -1,                                  \
+        .shm_history = 1,                           \
+        .history_minutes = HISTORY_DEFAULT_MINUTES, \
+        .history_mb = HISTORY_DEFAULT_MB,           \
+        .governor = true,                           \
+        .render_path = RENDER_PATH_AUTO,            \
+        .render_driver = NULL,                      \
     }
 
 #endif // CONFIG_H
\ No newline at end of file
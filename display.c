@@ -7,17 +7,85 @@ SPDX-License-Identifier: Apache-2.0
 
 #include "display.h"
 #include "config.h"
+#include "rgb565.h"
 
 #include <SDL3/SDL.h>
+#include <stdio.h>
+#include <string.h>
 
-bool init_sdl(const AppConfig *config, SDL_Window **out_window, SDL_Renderer **out_renderer) {
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Each pixel: 2 bytes: RRRRRGGG GGGBBBBB  (5-6-5)
+// buf index: (y * WIDTH + x) * 2
+static_assert(MC_EXPECTED_SIZE == WIDTH * HEIGHT * 2,
+              "MC_EXPECTED_SIZE must equal WIDTH * HEIGHT * 2");
+
+const char *render_path_name(RenderPath path) {
+    switch (path) {
+        case RENDER_PATH_AUTO:
+            return "auto";
+        case RENDER_PATH_RENDERER:
+            return "renderer";
+        case RENDER_PATH_SURFACE:
+            return "surface";
+    }
+    return "unknown";
+}
+
+static void draw_ready_pattern_renderer(SDL_Renderer *renderer, int cols, int rows) {
+    // Clear background (black)
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+    SDL_RenderClear(renderer);
+
+    // Draw a clear "READY" pattern using diagonal green/black stripes
+    // across the entire logical matrix. This avoids text layout issues
+    // and makes the ready state visually obvious until multicast data arrives.
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x < cols; ++x) {
+            // Simple diagonal pattern: periodic stripes based on x+y.
+            // Adjust modulus / threshold to tune density.
+            if (((x + y) % 4) < 2) {
+                SDL_SetRenderDrawColor(renderer, 0, 255, 0, 255); // green
+            } else {
+                SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255); // black
+            }
+            SDL_RenderPoint(renderer, x, y);
+        }
+    }
+
+    SDL_RenderPresent(renderer);
+}
+
+static void draw_ready_pattern_surface(Display *display) {
+    // Same diagonal stripes as the renderer path, fed through the regular
+    // surface upscaler as an RGB565 frame.
+    unsigned char frame[MC_EXPECTED_SIZE];
+    for (int y = 0; y < HEIGHT; ++y) {
+        for (int x = 0; x < WIDTH; ++x) {
+            size_t idx = (size_t)(y * WIDTH + x) * 2;
+            uint16_t color = (((x + y) % 4) < 2) ? 0x07E0 : 0x0000; // green / black
+            frame[idx] = (unsigned char)(color >> 8);
+            frame[idx + 1] = (unsigned char)(color & 0xFF);
+        }
+    }
+    display_frame(display, frame, sizeof(frame));
+}
+
+bool init_sdl(const AppConfig *config, Display *out_display) {
     if (!SDL_Init(SDL_INIT_VIDEO)) {
         return false;
     }
 
-    // Initial size based on logical 80x8 and initial scale.
-    const int init_w = config->width * config->scale;
-    const int init_h = config->height * config->scale;
+    // Initial size based on the logical matrix and initial scale.
+    const bool remapped = config->remap_width > 0 && config->remap_height > 0;
+    const int cols = remapped ? config->remap_width : config->width;
+    const int rows = remapped ? config->remap_height : config->height;
+    const int init_w = config->window_width > 0 ? config->window_width : cols * config->scale;
+    const int init_h = config->window_height > 0 ? config->window_height : rows * config->scale;
 
     SDL_Window *window = SDL_CreateWindow(
         config->title,
@@ -30,122 +98,524 @@ bool init_sdl(const AppConfig *config, SDL_Window **out_window, SDL_Renderer **o
     }
 
 #ifdef SDL_WINDOWPROP_MINIMUM_SIZE
-    SDL_SetWindowMinimumSize(window, config->width, config->height);
+    SDL_SetWindowMinimumSize(window, cols, rows);
 #endif
 
-    SDL_Renderer *renderer = SDL_CreateRenderer(window, NULL);
-    if (!renderer) {
+    memset(out_display, 0, sizeof(*out_display));
+    out_display->window = window;
+    out_display->path = config->render_path;
+    out_display->render_driver = config->render_driver;
+    out_display->path_auto = config->render_path == RENDER_PATH_AUTO && !config->render_driver;
+    out_display->cols = cols;
+    out_display->rows = rows;
+
+    // The on-screen table is always row-major; serpentine order is only
+    // for the headless outputs.
+    if (remapped) {
+        if (!remap_build(&out_display->remap, cols, rows, config->remap_filter, false)) {
+            SDL_DestroyWindow(window);
+            SDL_Quit();
+            return false;
+        }
+        out_display->remapped = true;
+    }
+
+    if (!color_lut_init(&out_display->lut, config)) {
+        remap_free(&out_display->remap);
         SDL_DestroyWindow(window);
         SDL_Quit();
         return false;
     }
 
-    // Clear background (black)
-    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-    SDL_RenderClear(renderer);
+    if (out_display->path != RENDER_PATH_SURFACE) {
+        SDL_Renderer *renderer = SDL_CreateRenderer(window, config->render_driver);
+        if (!renderer) {
+            color_lut_close(&out_display->lut);
+            remap_free(&out_display->remap);
+            SDL_DestroyWindow(window);
+            SDL_Quit();
+            return false;
+        }
 
-    // Draw a clear "READY" pattern using diagonal green/black stripes
-    // across the entire 80x8 logical matrix. This avoids text layout issues
-    // and makes the ready state visually obvious until multicast data arrives.
-    for (int y = 0; y < config->height; ++y) {
-        for (int x = 0; x < config->width; ++x) {
-            // Simple diagonal pattern: periodic stripes based on x+y.
-            // Adjust modulus / threshold to tune density.
-            if (((x + y) % 4) < 2) {
-                SDL_SetRenderDrawColor(renderer, 0, 255, 0, 255); // green
-            } else {
-                SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255); // black
-            }
-            SDL_RenderPoint(renderer, x, y);
+        // Without GPU acceleration SDL falls back to its software renderer,
+        // where every SDL_RenderFillRect goes through the generic rasterizer.
+        // Writing into the window surface ourselves is much cheaper there.
+        // SDL does not allow a renderer and the window surface API on the
+        // same window, so the renderer is dropped again.
+        const char *name = SDL_GetRendererName(renderer);
+        if (out_display->path == RENDER_PATH_AUTO && name && strcmp(name, SDL_SOFTWARE_RENDERER) == 0) {
+            SDL_DestroyRenderer(renderer);
+            out_display->path = RENDER_PATH_SURFACE;
+        } else {
+            out_display->renderer = renderer;
+            out_display->path = RENDER_PATH_RENDERER;
         }
     }
 
-    SDL_RenderPresent(renderer);
+    if (out_display->renderer) {
+        draw_ready_pattern_renderer(out_display->renderer, out_display->cols, out_display->rows);
+    } else {
+        draw_ready_pattern_surface(out_display);
+    }
 
-    *out_window = window;
-    *out_renderer = renderer;
     return true;
 }
 
-void draw_pixels_from_buffer(SDL_Renderer *renderer, const unsigned char *buf, size_t len) {
-    if (!renderer || !buf) {
-        return;
+void shutdown_sdl(Display *display) {
+    color_lut_close(&display->lut);
+    remap_free(&display->remap);
+    if (display->renderer) {
+        SDL_DestroyRenderer(display->renderer);
+        display->renderer = NULL;
     }
+    if (display->window) {
+        SDL_DestroyWindow(display->window);
+        display->window = NULL;
+    }
+    SDL_Quit();
+}
 
-    if (len != MC_EXPECTED_SIZE) {
-        // Ignore frames with unexpected size
-        return;
+void display_frame(Display *display, const unsigned char *buf, size_t len) {
+    if (display_decode(display, buf, len)) {
+        display_draw(display);
+        display_present(display);
     }
+}
 
-    SDL_Window *window = SDL_GetRenderWindow(renderer);
+static bool decode_mapped(Display *display, const unsigned char *buf);
 
-    int win_w = 0;
-    int win_h = 0;
-    SDL_GetRenderOutputSize(renderer, &win_w, &win_h);
+// full: redraw every LED, not only rows that differ from last_frame.
+static void redraw_last_frame(Display *display, bool full) {
+    // last_frame is already remapped, and decoding overwrites it, so decode
+    // from a copy in the remap buffer.
+    memcpy(display->remapped_frame, display->last_frame, (size_t)display->cols * (size_t)display->rows * 2);
+    if (full) {
+        display->have_last_frame = false;
+    }
+    if (decode_mapped(display, display->remapped_frame)) {
+        display_draw(display);
+        display_present(display);
+    }
+}
 
-    if (win_w <= 0 || win_h <= 0) {
+void display_refresh(Display *display) {
+    if (!display->have_last_frame || !color_lut_ready(&display->lut)) {
         return;
     }
+    redraw_last_frame(display, false);
+}
 
-    // Compute pixel size based on current window, preserving 80x8 aspect.
-    float pixel_size = (float)win_w / (float)WIDTH;
-    float max_pixel_from_height = (float)win_h / (float)HEIGHT;
-    if (pixel_size * HEIGHT > win_h) {
-        pixel_size = max_pixel_from_height;
+// Fill count 32-bit pixels with the same value, four or eight at a time
+// where SIMD is available.
+static inline void fill_span_u32(uint32_t *dst, int count, uint32_t value) {
+#if defined(__SSE2__)
+    const __m128i v = _mm_set1_epi32((int)value);
+    for (; count >= 8; count -= 8, dst += 8) {
+        _mm_storeu_si128((__m128i *)dst, v);
+        _mm_storeu_si128((__m128i *)(dst + 4), v);
+    }
+    for (; count >= 4; count -= 4, dst += 4) {
+        _mm_storeu_si128((__m128i *)dst, v);
+    }
+#elif defined(__ARM_NEON)
+    const uint32x4_t v = vdupq_n_u32(value);
+    for (; count >= 4; count -= 4, dst += 4) {
+        vst1q_u32(dst, v);
     }
+#endif
+    while (count-- > 0) {
+        *dst++ = value;
+    }
+}
 
+// Recompute where every LED lands on a w x h output, preserving the
+// matrix aspect and centering the matrix. The surface path uses the rounded
+// integer edges, the renderer path the float offsets.
+static bool compute_layout(Display *display, int w, int h) {
+    // Compute pixel size based on current window, preserving the aspect.
+    float pixel_size = (float)w / (float)display->cols;
+    if (pixel_size * (float)display->rows > h) {
+        pixel_size = (float)h / (float)display->rows;
+    }
     if (pixel_size <= 0.1f) {
-        return;
+        return false;
     }
 
-    // Center the 80x8 area within the window.
-    float used_w = pixel_size * (float)WIDTH;
-    float used_h = pixel_size * (float)HEIGHT;
-    float offset_x = ((float)win_w - used_w) * 0.5f;
-    float offset_y = ((float)win_h - used_h) * 0.5f;
+    // Center the matrix within the window.
+    float offset_x = ((float)w - pixel_size * (float)display->cols) * 0.5f;
+    float offset_y = ((float)h - pixel_size * (float)display->rows) * 0.5f;
+
+    for (int x = 0; x <= display->cols; ++x) {
+        int edge = (int)(offset_x + (float)x * pixel_size + 0.5f);
+        display->col_x[x] = SDL_clamp(edge, 0, w);
+    }
+    for (int y = 0; y <= display->rows; ++y) {
+        int edge = (int)(offset_y + (float)y * pixel_size + 0.5f);
+        display->row_y[y] = SDL_clamp(edge, 0, h);
+    }
+
+    display->out_w = w;
+    display->out_h = h;
+    display->pixel_size = pixel_size;
+    display->offset_x = offset_x;
+    display->offset_y = offset_y;
+    return true;
+}
+
+static void write_title(Display *display) {
+    if (!display->window) {
+        return;
+    }
 
     // Update window title with current scale and window size.
-    if (window) {
-        char title[256];
-        // pixel_size is in render-output pixels per logical LED.
-        SDL_snprintf(title,
-                     sizeof(title),
-                     "80x8 LedBanner - scale %.2f - %dx%d",
-                     pixel_size,
-                     win_w,
-                     win_h);
-        SDL_SetWindowTitle(window, title);
-    }
-
-    // Each pixel: 2 bytes: RRRRRGGG GGGBBBBB  (5-6-5)
-    // buf index: (y * WIDTH + x) * 2
-    static_assert(MC_EXPECTED_SIZE == WIDTH * HEIGHT * 2,
-                  "MC_EXPECTED_SIZE must equal WIDTH * HEIGHT * 2");
+    char title[256];
+    // pixel_size is in render-output pixels per logical LED.
+    SDL_snprintf(title,
+                 sizeof(title),
+                 "%dx%d LedBanner - scale %.2f - %dx%d%s%s",
+                 display->cols,
+                 display->rows,
+                 display->pixel_size,
+                 display->out_w,
+                 display->out_h,
+                 display->status[0] ? " - " : "",
+                 display->status);
+    SDL_SetWindowTitle(display->window, title);
+}
 
-    for (int y = 0; y < HEIGHT; ++y) {
-        for (int x = 0; x < WIDTH; ++x) {
-            size_t idx = (size_t)(y * WIDTH + x) * 2;
-            uint16_t raw = (uint16_t)((buf[idx] << 8) | buf[idx + 1]);
+// Per-frame title update, skipped while lean.
+static void update_title(Display *display) {
+    if (!display->lean) {
+        write_title(display);
+    }
+}
 
-            uint8_t r5 = (raw >> 11) & 0x1F;
-            uint8_t g6 = (raw >> 5) & 0x3F;
-            uint8_t b5 = raw & 0x1F;
+void display_set_status(Display *display, const char *status) {
+    SDL_snprintf(display->status, sizeof(display->status), "%s", status ? status : "");
+    write_title(display);
+}
+
+void display_set_lean(Display *display, bool lean) {
+    if (display->lean == lean) {
+        return;
+    }
+    display->lean = lean;
+    display->lean_frames = 0;
+    if (!lean) {
+        // Catch up with whatever changed while the title was frozen.
+        write_title(display);
+    }
+}
 
-            // Scale 5-bit and 6-bit to 8-bit
-            uint8_t r = (uint8_t)((r5 * 255 + 15) / 31);
-            uint8_t g = (uint8_t)((g6 * 255 + 31) / 63);
-            uint8_t b = (uint8_t)((b5 * 255 + 15) / 31);
+void display_set_cheap_path(Display *display, bool cheap) {
+    // An explicit --render or --render-driver stands.
+    if (!display->path_auto) {
+        return;
+    }
+    if (cheap && display->renderer) {
+        // Same switch init_sdl() makes for software renderers.
+        SDL_DestroyRenderer(display->renderer);
+        display->renderer = NULL;
+        display->path = RENDER_PATH_SURFACE;
+        display->left_renderer = true;
+        printf("Render path: surface (overload)\n");
+    } else if (!cheap && display->left_renderer) {
+        display->left_renderer = false;
+        SDL_DestroyWindowSurface(display->window);
+        display->surface = NULL;
+        SDL_Renderer *renderer = SDL_CreateRenderer(display->window, display->render_driver);
+        if (!renderer) {
+            fprintf(stderr, "Warning: renderer could not be recreated (%s), continuing on the surface path\n", SDL_GetError());
+            return;
+        }
+        display->renderer = renderer;
+        display->path = RENDER_PATH_RENDERER;
+        printf("Render path: renderer (%s)\n", SDL_GetRendererName(renderer));
+    } else {
+        return;
+    }
+    fflush(stdout);
+
+    // The new path starts from a blank window.
+    display->out_w = 0;
+    display->out_h = 0;
+    if (display->have_last_frame) {
+        redraw_last_frame(display, true);
+    }
+}
+
+float display_refresh_rate(const Display *display) {
+    const SDL_DisplayMode *mode = SDL_GetCurrentDisplayMode(SDL_GetDisplayForWindow(display->window));
+    return mode ? mode->refresh_rate : 0.0f;
+}
+
+static bool decode_for_renderer(Display *display, const unsigned char *buf) {
+    // Lean: keep the layout, and only look for a resize now and then.
+    const bool check_size = !display->lean || display->out_w == 0 ||
+                            ++display->lean_frames >= DISPLAY_LEAN_LAYOUT_FRAMES;
+    if (check_size) {
+        display->lean_frames = 0;
+
+        int win_w = 0;
+        int win_h = 0;
+        SDL_GetRenderOutputSize(display->renderer, &win_w, &win_h);
+
+        if (win_w <= 0 || win_h <= 0) {
+            return false;
+        }
+
+        if ((!display->lean || win_w != display->out_w || win_h != display->out_h) &&
+            !compute_layout(display, win_w, win_h)) {
+            return false;
+        }
+    }
+
+    // The back buffer is undefined after a present, so every LED is redrawn.
+    const uint32_t *lut = display->lut.front;
+    const int leds = display->cols * display->rows;
+    for (int i = 0; i < leds; ++i) {
+        display->led_pixels[i] = lut[rgb565_at(&buf[i * 2])];
+    }
+    memcpy(display->last_frame, buf, (size_t)leds * 2);
+    display->have_last_frame = true;
+    for (int y = 0; y < display->rows; ++y) {
+        display->dirty_rows[y] = true;
+    }
+    display->dirty_count = display->rows;
+    display->full_redraw = true;
+    return true;
+}
+
+static bool decode_for_surface(Display *display, const unsigned char *buf) {
+    SDL_Surface *surface = SDL_GetWindowSurface(display->window);
+    if (!surface || surface->w <= 0 || surface->h <= 0) {
+        return false;
+    }
+
+    bool full_redraw = !display->have_last_frame ||
+                       surface->w != display->out_w ||
+                       surface->h != display->out_h ||
+                       surface->format != display->surface_format;
+
+    if (full_redraw) {
+        if (!compute_layout(display, surface->w, surface->h)) {
+            return false;
+        }
+        display->surface_format = surface->format;
+    }
+
+    // The table is ARGB8888, which is what window surfaces almost always
+    // are; anything else is mapped per LED.
+    const uint32_t *lut = display->lut.front;
+    const bool lut_native = surface->format == SDL_PIXELFORMAT_ARGB8888 ||
+                            surface->format == SDL_PIXELFORMAT_XRGB8888;
+
+    // Decode only the LED rows that differ from the previous frame.
+    const int cols = display->cols;
+    const size_t row_bytes = (size_t)cols * 2;
+    int dirty_count = 0;
+    for (int y = 0; y < display->rows; ++y) {
+        const unsigned char *row = &buf[y * row_bytes];
+        bool dirty = full_redraw || memcmp(row, &display->last_frame[y * row_bytes], row_bytes) != 0;
+        display->dirty_rows[y] = dirty;
+        if (!dirty) {
+            continue;
+        }
+        dirty_count++;
+
+        uint32_t *out = &display->led_pixels[y * cols];
+        if (lut_native) {
+            for (int x = 0; x < cols; ++x) {
+                out[x] = lut[rgb565_at(&row[x * 2])];
+            }
+        } else {
+            for (int x = 0; x < cols; ++x) {
+                uint32_t argb = lut[rgb565_at(&row[x * 2])];
+                out[x] = SDL_MapSurfaceRGB(surface, (uint8_t)(argb >> 16), (uint8_t)(argb >> 8), (uint8_t)argb);
+            }
+        }
+    }
+
+    memcpy(display->last_frame, buf, row_bytes * (size_t)display->rows);
+    display->have_last_frame = true;
+
+    display->surface = surface;
+    display->dirty_count = dirty_count;
+    display->full_redraw = full_redraw;
+    return dirty_count > 0;
+}
+
+// Decodes a frame already in the display's geometry.
+static bool decode_mapped(Display *display, const unsigned char *buf) {
+    // A new colour table changes every LED.
+    if (color_lut_swap(&display->lut)) {
+        display->have_last_frame = false;
+    }
+
+    if (display->path == RENDER_PATH_SURFACE) {
+        return decode_for_surface(display, buf);
+    }
+    if (!display->renderer) {
+        return false;
+    }
+    return decode_for_renderer(display, buf);
+}
+
+bool display_decode(Display *display, const unsigned char *buf, size_t len) {
+    if (!display || !display->window || !buf) {
+        return false;
+    }
+
+    if (len != MC_EXPECTED_SIZE) {
+        // Ignore frames with unexpected size
+        return false;
+    }
+
+    // One gather pass through the precomputed table.
+    if (display->remapped) {
+        remap_apply(&display->remap, buf, display->remapped_frame);
+        buf = display->remapped_frame;
+    }
+    return decode_mapped(display, buf);
+}
+
+static void draw_to_renderer(Display *display) {
+    SDL_Renderer *renderer = display->renderer;
+
+    update_title(display);
+
+    const float pixel_size = display->pixel_size;
+    for (int y = 0; y < display->rows; ++y) {
+        for (int x = 0; x < display->cols; ++x) {
+            uint32_t rgb = display->led_pixels[y * display->cols + x];
 
             SDL_FRect rct;
-            rct.x = offset_x + (float)x * pixel_size;
-            rct.y = offset_y + (float)y * pixel_size;
+            rct.x = display->offset_x + (float)x * pixel_size;
+            rct.y = display->offset_y + (float)y * pixel_size;
             rct.w = pixel_size;
             rct.h = pixel_size;
 
-            SDL_SetRenderDrawColor(renderer, r, g, b, 255);
+            SDL_SetRenderDrawColor(renderer, (uint8_t)(rgb >> 16), (uint8_t)(rgb >> 8), (uint8_t)rgb, 255);
             SDL_RenderFillRect(renderer, &rct);
         }
     }
+}
 
-    SDL_RenderPresent(renderer);
-}
\ No newline at end of file
+// Build one LED row on its first scanline, then replicate that scanline
+// down over the remaining scanlines of the row.
+static void upscale_row_u32(const Display *display, SDL_Surface *surface, int y) {
+    const int y0 = display->row_y[y];
+    const int y1 = display->row_y[y + 1];
+    if (y1 <= y0) {
+        return;
+    }
+
+    unsigned char *pixels = (unsigned char *)surface->pixels;
+    uint32_t *first = (uint32_t *)(pixels + (size_t)y0 * (size_t)surface->pitch);
+    const uint32_t *leds = &display->led_pixels[y * display->cols];
+
+    for (int x = 0; x < display->cols; ++x) {
+        const int x0 = display->col_x[x];
+        fill_span_u32(first + x0, display->col_x[x + 1] - x0, leds[x]);
+    }
+
+    const int x_begin = display->col_x[0];
+    const size_t span_bytes = (size_t)(display->col_x[display->cols] - x_begin) * sizeof(uint32_t);
+    for (int sy = y0 + 1; sy < y1; ++sy) {
+        uint32_t *line = (uint32_t *)(pixels + (size_t)sy * (size_t)surface->pitch);
+        memcpy(line + x_begin, first + x_begin, span_bytes);
+    }
+}
+
+// Fallback for surfaces that are not 32 bits per pixel: let SDL fill the
+// LED rectangles in whatever format the surface has.
+static void upscale_row_generic(const Display *display, SDL_Surface *surface, int y) {
+    const uint32_t *leds = &display->led_pixels[y * display->cols];
+    for (int x = 0; x < display->cols; ++x) {
+        SDL_Rect rct;
+        rct.x = display->col_x[x];
+        rct.y = display->row_y[y];
+        rct.w = display->col_x[x + 1] - rct.x;
+        rct.h = display->row_y[y + 1] - rct.y;
+        SDL_FillSurfaceRect(surface, &rct, leds[x]);
+    }
+}
+
+static void draw_to_surface(Display *display) {
+    SDL_Surface *surface = display->surface;
+    if (!surface) {
+        return;
+    }
+
+    if (display->full_redraw) {
+        update_title(display);
+
+        // Clear the letterbox area (black) once; LED rows overwrite the rest.
+        SDL_FillSurfaceRect(surface, NULL, SDL_MapSurfaceRGB(surface, 0, 0, 0));
+    }
+
+    const bool fast = SDL_BYTESPERPIXEL(surface->format) == 4;
+    const bool locked = fast && SDL_MUSTLOCK(surface);
+    if (locked && !SDL_LockSurface(surface)) {
+        return;
+    }
+
+    for (int y = 0; y < display->rows; ++y) {
+        if (!display->dirty_rows[y]) {
+            continue;
+        }
+        if (fast) {
+            upscale_row_u32(display, surface, y);
+        } else {
+            upscale_row_generic(display, surface, y);
+        }
+    }
+
+    if (locked) {
+        SDL_UnlockSurface(surface);
+    }
+}
+
+void display_draw(Display *display) {
+    if (display->path == RENDER_PATH_SURFACE) {
+        draw_to_surface(display);
+    } else {
+        draw_to_renderer(display);
+    }
+}
+
+static void present_surface(Display *display) {
+    if (display->full_redraw) {
+        SDL_UpdateWindowSurface(display->window);
+        return;
+    }
+
+    // Push only the changed LED rows, merging adjacent rows into one rect.
+    SDL_Rect rects[REMAP_MAX_HEIGHT];
+    int rect_count = 0;
+    for (int y = 0; y < display->rows; ++y) {
+        if (!display->dirty_rows[y]) {
+            continue;
+        }
+        int end = y;
+        while (end + 1 < display->rows && display->dirty_rows[end + 1]) {
+            end++;
+        }
+        rects[rect_count].x = display->col_x[0];
+        rects[rect_count].y = display->row_y[y];
+        rects[rect_count].w = display->col_x[display->cols] - display->col_x[0];
+        rects[rect_count].h = display->row_y[end + 1] - display->row_y[y];
+        rect_count++;
+        y = end;
+    }
+    SDL_UpdateWindowSurfaceRects(display->window, rects, rect_count);
+}
+
+void display_present(Display *display) {
+    if (display->path == RENDER_PATH_SURFACE) {
+        present_surface(display);
+        display->surface = NULL;
+    } else {
+        SDL_RenderPresent(display->renderer);
+    }
+}
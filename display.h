@@ -8,12 +8,93 @@ SPDX-License-Identifier: Apache-2.0
 #ifndef DISPLAY_H
 #define DISPLAY_H
 
+#include "colorlut.h"
 #include "config.h"
+#include "remap.h"
 #include <SDL3/SDL.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
-bool init_sdl(const AppConfig *config, SDL_Window **out_window, SDL_Renderer **out_renderer);
-void draw_pixels_from_buffer(SDL_Renderer *renderer, const unsigned char *buf, size_t len);
+// Lean renderer path: frames between checks for a changed output size.
+#define DISPLAY_LEAN_LAYOUT_FRAMES 30
 
-#endif // DISPLAY_H
\ No newline at end of file
+typedef struct Display {
+    SDL_Window *window;
+    SDL_Renderer *renderer; // NULL on the surface path
+    RenderPath path;        // resolved path, never RENDER_PATH_AUTO
+    const char *render_driver;
+    bool path_auto;     // --render auto without --render-driver: the path may change at runtime
+    bool left_renderer; // on the surface path for display_set_cheap_path()
+
+    // LED matrix shown: the stream's 80x8, or the --remap target.
+    int cols;
+    int rows;
+    bool remapped;
+    RemapTable remap;
+    unsigned char remapped_frame[REMAP_MAX_FRAME_SIZE];
+
+    // Layout of the LED matrix on the output, recomputed by
+    // display_decode() whenever the output size changes.
+    int out_w;
+    int out_h;
+    float pixel_size;
+    float offset_x;
+    float offset_y;
+    int col_x[REMAP_MAX_WIDTH + 1];  // left edge of each LED column, in output pixels
+    int row_y[REMAP_MAX_HEIGHT + 1]; // top edge of each LED row, in output pixels
+
+    // RGB565 to ARGB8888 through the active colour profile.
+    ColorLut lut;
+
+    // Decoded frame, handed from display_decode() to display_draw().
+    // Renderer path: 0xAARRGGBB. Surface path: surface pixel format.
+    uint32_t led_pixels[REMAP_MAX_WIDTH * REMAP_MAX_HEIGHT];
+    bool dirty_rows[REMAP_MAX_HEIGHT];
+    int dirty_count;
+    bool full_redraw;
+
+    // Last frame decoded (after remapping), on both paths. On the surface
+    // path a change of surface size, format or colour table forces a full
+    // redraw; otherwise only rows that differ from last_frame are touched.
+    unsigned char last_frame[REMAP_MAX_FRAME_SIZE];
+    bool have_last_frame;
+
+    // Appended to the window title, empty = none.
+    char status[64];
+
+    // Lean: no title updates, layout kept between frames.
+    bool lean;
+    int lean_frames;
+
+    // Surface path state.
+    SDL_Surface *surface; // valid between display_decode() and display_present()
+    SDL_PixelFormat surface_format;
+} Display;
+
+bool init_sdl(const AppConfig *config, Display *out_display);
+void shutdown_sdl(Display *display);
+const char *render_path_name(RenderPath path);
+
+// A frame goes through three stages, kept separate so they can be timed
+// individually. display_frame() runs all three. Frames are always the
+// stream's 80x8; display_decode() remaps them when --remap is set.
+bool display_decode(Display *display, const unsigned char *buf, size_t len); // false: nothing to draw
+void display_draw(Display *display);
+void display_present(Display *display);
+void display_frame(Display *display, const unsigned char *buf, size_t len);
+// Redraws the last frame once a new colour table is ready, so a profile
+// switch shows without waiting for the next frame.
+void display_refresh(Display *display);
+// Shows text after the scale and size in the window title; NULL clears it.
+void display_set_status(Display *display, const char *status);
+
+// Under overload: lean skips per-frame title and layout work; cheap path
+// drops the renderer for the surface path, and switching back recreates it,
+// only if the path was left to auto. A path switch redraws the last frame.
+void display_set_lean(Display *display, bool lean);
+void display_set_cheap_path(Display *display, bool cheap);
+// Of the screen the window is on, in Hz; 0 if unknown.
+float display_refresh_rate(const Display *display);
+
+#endif // DISPLAY_H
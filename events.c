@@ -8,7 +8,9 @@ SPDX-License-Identifier: Apache-2.0
 #include "events.h"
 #include <SDL3/SDL.h>
 
-bool handle_sdl_events(bool *running) {
+bool handle_sdl_events(bool *running, InputActions *actions) {
+    *actions = (InputActions){0};
+
     SDL_Event e;
     while (SDL_PollEvent(&e)) {
         if (e.type == SDL_EVENT_QUIT) {
@@ -16,6 +18,22 @@ bool handle_sdl_events(bool *running) {
         } else if (e.type == SDL_EVENT_KEY_DOWN) {
             if (e.key.key == SDLK_ESCAPE) {
                 *running = false;
+            } else if (e.key.key == SDLK_C && !e.key.repeat) {
+                actions->next_color_profile = true;
+            } else if (e.key.key == SDLK_SPACE && !e.key.repeat) {
+                actions->toggle_pause = !actions->toggle_pause;
+            } else if (e.key.key == SDLK_LEFT || e.key.key == SDLK_RIGHT) {
+                // Key repeat is welcome here: holding an arrow plays frames.
+                int frames = (e.key.mod & SDL_KMOD_SHIFT) ? 10 : 1;
+                actions->step += e.key.key == SDLK_LEFT ? -frames : frames;
+            } else if (e.key.key == SDLK_PAGEUP) {
+                actions->scrub_seconds -= 5;
+            } else if (e.key.key == SDLK_PAGEDOWN) {
+                actions->scrub_seconds += 5;
+            } else if (e.key.key == SDLK_HOME) {
+                actions->jump_oldest = true;
+            } else if (e.key.key == SDLK_END) {
+                actions->go_live = true;
             }
         }
     }
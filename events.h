@@ -10,6 +10,18 @@ SPDX-License-Identifier: Apache-2.0
 
 #include <stdbool.h>
 
-bool handle_sdl_events(bool *running);
+// Keyboard requests for the main loop, reset on every call.
+typedef struct InputActions {
+    bool next_color_profile; // C
+
+    // Rewind history.
+    bool toggle_pause; // Space
+    int step;          // Left/Right: frames, Shift for 10
+    int scrub_seconds; // Page Up/Page Down: 5 seconds
+    bool jump_oldest;  // Home
+    bool go_live;      // End
+} InputActions;
+
+bool handle_sdl_events(bool *running, InputActions *actions);
 
 #endif // EVENTS_H
\ No newline at end of file
@@ -0,0 +1,341 @@
+/*
+
+Copyright 2025 Marc Ketel
+SPDX-License-Identifier: Apache-2.0
+
+*/
+
+#include "framebus.h"
+#include "timeutil.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static_assert(sizeof(FrameBusHeader) <= FRAMEBUS_HEADER_SIZE, "FrameBusHeader must fit in FRAMEBUS_HEADER_SIZE");
+static_assert(sizeof(FrameBusSlot) % 8 == 0, "frame data must stay 8-byte aligned");
+
+#define FRAMEBUS_READ_ATTEMPTS 100000
+
+static size_t slot_stride_for(size_t frame_size) {
+    size_t stride = sizeof(FrameBusSlot) + frame_size;
+    return (stride + FRAMEBUS_SLOT_ALIGN - 1) & ~(size_t)(FRAMEBUS_SLOT_ALIGN - 1);
+}
+
+static FrameBusSlot *slot_for(unsigned char *base, const FrameBusHeader *h, uint64_t frame_no) {
+    size_t idx = (size_t)((frame_no - 1) % h->slot_count);
+    return (FrameBusSlot *)(base + FRAMEBUS_HEADER_SIZE + idx * h->slot_stride);
+}
+
+static long futex_call(_Atomic uint32_t *addr, int op, uint32_t val, const struct timespec *timeout) {
+    return syscall(SYS_futex, (uint32_t *)addr, op, val, timeout, NULL, 0);
+}
+
+bool framebus_open_writer(
+    FrameBusWriter *w, const char *name, uint32_t width, uint32_t height, uint32_t pixel_order, uint32_t history) {
+    memset(w, 0, sizeof(*w));
+
+    if (history < 1 || history > FRAMEBUS_MAX_HISTORY) {
+        fprintf(stderr, "Invalid frame bus history: %u (must be 1-%d)\n", history, FRAMEBUS_MAX_HISTORY);
+        return false;
+    }
+    if (!name || name[0] != '/' || strlen(name) >= sizeof(w->name)) {
+        fprintf(stderr, "Invalid frame bus name: %s (expected /name)\n", name ? name : "(null)");
+        return false;
+    }
+
+    const size_t frame_size = (size_t)width * height * 2;
+    const size_t stride = slot_stride_for(frame_size);
+    const size_t map_len = FRAMEBUS_HEADER_SIZE + stride * history;
+
+    // Start from a fresh region so a reader never sees a stale layout.
+    shm_unlink(name);
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        perror("shm_open");
+        return false;
+    }
+
+    if (ftruncate(fd, (off_t)map_len) < 0) {
+        perror("ftruncate(frame bus)");
+        close(fd);
+        shm_unlink(name);
+        return false;
+    }
+
+    void *base = mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror("mmap(frame bus)");
+        shm_unlink(name);
+        return false;
+    }
+
+    snprintf(w->name, sizeof(w->name), "%s", name);
+    w->base = base;
+    w->map_len = map_len;
+    w->header = base;
+
+    FrameBusHeader *h = w->header;
+    h->width = width;
+    h->height = height;
+    h->frame_size = (uint32_t)frame_size;
+    h->slot_count = history;
+    h->slot_stride = (uint32_t)stride;
+    h->writer_pid = (uint32_t)getpid();
+    h->pixel_order = pixel_order;
+    h->version = FRAMEBUS_VERSION;
+
+    // Readers check the magic, so it goes in last, once the layout is in place.
+    atomic_thread_fence(memory_order_release);
+    h->magic = FRAMEBUS_MAGIC;
+
+    printf("Frame bus: publishing %ux%u%s frames to /dev/shm%s (%u frame history)\n",
+           width,
+           height,
+           pixel_order == FRAMEBUS_ORDER_SERPENTINE ? " serpentine" : "",
+           name,
+           history);
+    return true;
+}
+
+void framebus_publish(FrameBusWriter *w, const unsigned char *frame, size_t len, const struct timespec *rx_ts) {
+    if (!w->base) {
+        return;
+    }
+
+    FrameBusHeader *h = w->header;
+    if (len != h->frame_size) {
+        return;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    const uint64_t frame_no = ++w->frame_no;
+    FrameBusSlot *slot = slot_for(w->base, h, frame_no);
+
+    // Seqlock write: odd sequence, payload, even sequence. The release
+    // fence keeps the payload stores from moving above the odd store.
+    uint32_t seq = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+    atomic_store_explicit(&slot->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    slot->frame_size = (uint32_t)len;
+    slot->frame_no = frame_no;
+    slot->rx_ns = rx_ts ? timespec_to_ns(rx_ts) : 0;
+    slot->publish_ns = timespec_to_ns(&now);
+    memcpy((unsigned char *)(slot + 1), frame, len);
+
+    atomic_store_explicit(&slot->seq, seq + 2, memory_order_release);
+    atomic_store_explicit(&h->head, frame_no, memory_order_release);
+
+    // Wake sleepers only; readers that poll never cost a syscall.
+    atomic_fetch_add_explicit(&h->futex, 1, memory_order_seq_cst);
+    if (atomic_load_explicit(&h->waiters, memory_order_seq_cst) > 0) {
+        futex_call(&h->futex, FUTEX_WAKE, INT_MAX, NULL);
+    }
+}
+
+void framebus_close_writer(FrameBusWriter *w) {
+    if (w->base) {
+        munmap(w->base, w->map_len);
+        shm_unlink(w->name);
+    }
+    memset(w, 0, sizeof(*w));
+}
+
+bool framebus_open_reader(FrameBusReader *r, const char *name) {
+    memset(r, 0, sizeof(*r));
+
+    // Read-write lets the reader register as a futex waiter; a read-only
+    // mapping still works but has to wait in short sleeps.
+    bool writable = true;
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0 && errno == EACCES) {
+        writable = false;
+        fd = shm_open(name, O_RDONLY, 0);
+    }
+    if (fd < 0) {
+        fprintf(stderr, "Frame bus %s: %s\n", name, strerror(errno));
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < FRAMEBUS_HEADER_SIZE) {
+        fprintf(stderr, "Frame bus %s: region too small\n", name);
+        close(fd);
+        return false;
+    }
+
+    const size_t map_len = (size_t)st.st_size;
+    void *base = mmap(NULL, map_len, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror("mmap(frame bus)");
+        return false;
+    }
+
+    FrameBusHeader *h = base;
+    uint32_t magic = h->magic;
+    atomic_thread_fence(memory_order_acquire);
+    if (magic != FRAMEBUS_MAGIC || h->version != FRAMEBUS_VERSION || h->slot_count < 1 ||
+        h->slot_stride < slot_stride_for(h->frame_size) ||
+        FRAMEBUS_HEADER_SIZE + (size_t)h->slot_stride * h->slot_count > map_len) {
+        fprintf(stderr, "Frame bus %s: not a version %d frame bus region\n", name, FRAMEBUS_VERSION);
+        munmap(base, map_len);
+        return false;
+    }
+
+    r->base = base;
+    r->map_len = map_len;
+    r->header = h;
+    r->writable = writable;
+    return true;
+}
+
+uint64_t framebus_latest_frame_no(const FrameBusReader *r) {
+    return atomic_load_explicit(&r->header->head, memory_order_acquire);
+}
+
+bool framebus_read_frame(const FrameBusReader *r, uint64_t frame_no, unsigned char *buf, size_t buf_len, FrameBusFrameInfo *info) {
+    const FrameBusHeader *h = r->header;
+    if (frame_no == 0 || buf_len < h->frame_size) {
+        return false;
+    }
+
+    FrameBusSlot *slot = slot_for((unsigned char *)r->base, h, frame_no);
+
+    // A writer only holds a slot for one memcpy; give up if it looks stuck
+    // (e.g. it died mid-update).
+    for (int attempt = 0; attempt < FRAMEBUS_READ_ATTEMPTS; ++attempt) {
+        uint32_t seq1 = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        if (seq1 & 1) {
+            continue; // writer is mid-update
+        }
+
+        FrameBusFrameInfo copy;
+        copy.frame_no = slot->frame_no;
+        copy.rx_ns = slot->rx_ns;
+        copy.publish_ns = slot->publish_ns;
+        copy.frame_size = slot->frame_size;
+        if (copy.frame_size > buf_len) {
+            copy.frame_size = buf_len;
+        }
+        memcpy(buf, (const unsigned char *)(slot + 1), copy.frame_size);
+
+        atomic_thread_fence(memory_order_acquire);
+        uint32_t seq2 = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+        if (seq1 != seq2) {
+            continue; // torn read, try again
+        }
+
+        // The slot may already hold a newer frame (history overrun) or not
+        // the requested one yet.
+        if (copy.frame_no != frame_no) {
+            return false;
+        }
+
+        if (info) {
+            *info = copy;
+        }
+        return true;
+    }
+    return false;
+}
+
+bool framebus_read_latest(const FrameBusReader *r, unsigned char *buf, size_t buf_len, FrameBusFrameInfo *info) {
+    for (;;) {
+        uint64_t head = framebus_latest_frame_no(r);
+        if (head == 0) {
+            return false;
+        }
+        if (framebus_read_frame(r, head, buf, buf_len, info)) {
+            return true;
+        }
+        if (framebus_latest_frame_no(r) == head) {
+            return false; // stuck writer
+        }
+        // Overtaken by the writer between loading head and copying.
+    }
+}
+
+uint64_t framebus_wait(FrameBusReader *r, uint64_t last_seen, int timeout_ms) {
+    FrameBusHeader *h = r->header;
+
+    uint64_t head = framebus_latest_frame_no(r);
+    if (head > last_seen) {
+        return head;
+    }
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    for (;;) {
+        // Sample the futex word before re-checking head: a publish after
+        // the sample changes the word and FUTEX_WAIT returns at once.
+        uint32_t word = atomic_load_explicit(&h->futex, memory_order_seq_cst);
+        if (r->writable) {
+            atomic_fetch_add_explicit(&h->waiters, 1, memory_order_seq_cst);
+        }
+
+        head = framebus_latest_frame_no(r);
+        if (head > last_seen) {
+            if (r->writable) {
+                atomic_fetch_sub_explicit(&h->waiters, 1, memory_order_seq_cst);
+            }
+            return head;
+        }
+
+        struct timespec rel = {0, 0};
+        const struct timespec *timeout = NULL;
+        if (timeout_ms >= 0) {
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            long long left_ns = (long long)(deadline.tv_sec - now.tv_sec) * 1000000000LL + (deadline.tv_nsec - now.tv_nsec);
+            if (left_ns <= 0) {
+                if (r->writable) {
+                    atomic_fetch_sub_explicit(&h->waiters, 1, memory_order_seq_cst);
+                }
+                return 0;
+            }
+            rel.tv_sec = (time_t)(left_ns / 1000000000LL);
+            rel.tv_nsec = (long)(left_ns % 1000000000LL);
+            timeout = &rel;
+        }
+
+        // Without a waiter registration nobody wakes us, so sleep in
+        // 1 ms slices.
+        struct timespec slice = {0, 1000000L};
+        if (!r->writable && (!timeout || rel.tv_sec > 0 || rel.tv_nsec > slice.tv_nsec)) {
+            timeout = &slice;
+        }
+
+        futex_call(&h->futex, FUTEX_WAIT, word, timeout);
+
+        if (r->writable) {
+            atomic_fetch_sub_explicit(&h->waiters, 1, memory_order_seq_cst);
+        }
+    }
+}
+
+void framebus_close_reader(FrameBusReader *r) {
+    if (r->base) {
+        munmap((void *)r->base, r->map_len);
+    }
+    memset(r, 0, sizeof(*r));
+}
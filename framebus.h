@@ -0,0 +1,116 @@
+/*
+
+Copyright 2025 Marc Ketel
+SPDX-License-Identifier: Apache-2.0
+
+*/
+
+/*
+ * Shared-memory frame bus.
+ *
+ * The receiver publishes every validated frame into a POSIX shared memory
+ * region (/dev/shm/<name>) so local consumers get the live frames without
+ * joining the multicast group themselves. The region holds a small ring of
+ * the most recent frames, each guarded by its own seqlock, plus a futex
+ * word that is bumped on every publish.
+ *
+ * Readers never block the writer. Reading a frame is a plain copy plus two
+ * sequence loads; waiting for a new frame only enters the kernel when
+ * there is nothing new yet, and the writer only issues FUTEX_WAKE when a
+ * reader is actually sleeping.
+ *
+ * The writer recreates the region on startup, so readers should reopen it
+ * when writer_pid changes or the process is gone.
+ */
+
+#ifndef FRAMEBUS_H
+#define FRAMEBUS_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#define FRAMEBUS_DEFAULT_NAME "/ledbanner"
+#define FRAMEBUS_MAGIC        0x4C454442u // "LEDB"
+#define FRAMEBUS_VERSION      2 // 2: pixel_order; version 1 readers would misread serpentine frames
+#define FRAMEBUS_MAX_HISTORY  1024
+#define FRAMEBUS_HEADER_SIZE  128 // FrameBusHeader, padded to two cache lines
+#define FRAMEBUS_SLOT_ALIGN   64
+
+// FrameBusHeader.pixel_order
+#define FRAMEBUS_ORDER_ROW_MAJOR  0 // every row left to right
+#define FRAMEBUS_ORDER_SERPENTINE 1 // odd rows (0-based) right to left
+
+// Region header at offset 0. The fields above head never change after
+// the writer created the region.
+typedef struct FrameBusHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;       // frame width in pixels
+    uint32_t height;      // frame height in pixels
+    uint32_t frame_size;  // bytes per frame (RGB565, big endian, in pixel_order)
+    uint32_t slot_count;  // frames of history kept, >= 1
+    uint32_t slot_stride; // bytes per slot including its FrameBusSlot header
+    uint32_t writer_pid;
+    uint32_t pixel_order; // FRAMEBUS_ORDER_*
+
+    // Written on every publish, on their own cache line.
+    _Alignas(64) _Atomic uint64_t head; // frame number of the newest complete frame, 0 = none yet
+    _Atomic uint32_t futex;             // incremented after every publish
+    _Atomic uint32_t waiters;           // readers sleeping on futex
+} FrameBusHeader;
+
+// Slot header; the frame data follows it directly. Slots start at
+// FRAMEBUS_HEADER_SIZE and are slot_stride bytes apart. Frame n (1-based)
+// lives in slot (n - 1) % slot_count.
+typedef struct FrameBusSlot {
+    _Atomic uint32_t seq; // seqlock: odd while the writer is updating the slot
+    uint32_t frame_size;
+    uint64_t frame_no;
+    uint64_t rx_ns;      // kernel receive time, CLOCK_REALTIME ns, 0 if unknown
+    uint64_t publish_ns; // time the frame was published, CLOCK_REALTIME ns
+} FrameBusSlot;
+
+typedef struct FrameBusFrameInfo {
+    uint64_t frame_no;
+    uint64_t rx_ns;
+    uint64_t publish_ns;
+    size_t frame_size;
+} FrameBusFrameInfo;
+
+typedef struct FrameBusWriter {
+    char name[64];
+    unsigned char *base;
+    size_t map_len;
+    FrameBusHeader *header;
+    uint64_t frame_no;
+} FrameBusWriter;
+
+typedef struct FrameBusReader {
+    const unsigned char *base;
+    size_t map_len;
+    FrameBusHeader *header;
+    bool writable; // mapped read-write, so it can register as a futex waiter
+} FrameBusReader;
+
+// Writer side, used by the receiver.
+bool framebus_open_writer(
+    FrameBusWriter *w, const char *name, uint32_t width, uint32_t height, uint32_t pixel_order, uint32_t history);
+void framebus_publish(FrameBusWriter *w, const unsigned char *frame, size_t len, const struct timespec *rx_ts);
+void framebus_close_writer(FrameBusWriter *w);
+
+// Reader side. All reads copy into the caller's buffer, which must hold
+// header->frame_size bytes; they return false if there is no such frame
+// (yet, or any more).
+bool framebus_open_reader(FrameBusReader *r, const char *name);
+uint64_t framebus_latest_frame_no(const FrameBusReader *r);
+bool framebus_read_latest(const FrameBusReader *r, unsigned char *buf, size_t buf_len, FrameBusFrameInfo *info);
+bool framebus_read_frame(const FrameBusReader *r, uint64_t frame_no, unsigned char *buf, size_t buf_len, FrameBusFrameInfo *info);
+// Returns the newest frame number once it is greater than last_seen, or
+// 0 on timeout (timeout_ms < 0 waits forever).
+uint64_t framebus_wait(FrameBusReader *r, uint64_t last_seen, int timeout_ms);
+void framebus_close_reader(FrameBusReader *r);
+
+#endif // FRAMEBUS_H
@@ -0,0 +1,214 @@
+/*
+
+Copyright 2025 Marc Ketel
+SPDX-License-Identifier: Apache-2.0
+
+*/
+
+/*
+ * Example frame bus consumer.
+ *
+ * Follows the frames led80x8 publishes with --shm and prints one line per
+ * frame with the receive -> publish and publish -> read latency. Frames
+ * the history ring could not cover are reported as skipped. With --record
+ * the raw frames are appended to a file that render_bench --frames-file
+ * can replay.
+ */
+
+#include "framebus.h"
+
+#include <errno.h>
+#include <getopt.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void handle_signal(int sig) {
+    (void)sig;
+    stop_requested = 1;
+}
+
+static void print_usage(FILE *out, const char *prog) {
+    fprintf(out,
+            "Usage: %s [options]\n"
+            "\n"
+            "Options:\n"
+            "  -n, --name NAME      frame bus to read (default: %s)\n"
+            "  -c, --count N        exit after N frames (default: run until interrupted)\n"
+            "      --record FILE    append raw frames to FILE (render_bench --frames-file format)\n"
+            "  -q, --quiet          no per-frame output, summary only\n"
+            "  -h, --help           show this help and exit\n",
+            prog,
+            FRAMEBUS_DEFAULT_NAME);
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// A positive decimal count, the whole argument.
+static bool parse_count(const char *arg, long *out) {
+    char *end = NULL;
+    errno = 0;
+    long v = strtol(arg, &end, 10);
+    if (end == arg || *end != '\0' || errno == ERANGE || v <= 0) {
+        return false;
+    }
+    *out = v;
+    return true;
+}
+
+static double us_between(uint64_t from_ns, uint64_t to_ns) {
+    if (from_ns == 0 || to_ns < from_ns) {
+        return 0.0;
+    }
+    return (double)(to_ns - from_ns) / 1000.0;
+}
+
+int main(int argc, char **argv) {
+    static const struct option long_options[] = {
+        {"name", required_argument, NULL, 'n'},
+        {"count", required_argument, NULL, 'c'},
+        {"record", required_argument, NULL, 'R'},
+        {"quiet", no_argument, NULL, 'q'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+
+    const char *prog = (argc > 0 && argv[0]) ? argv[0] : "framebus_reader";
+    const char *name = FRAMEBUS_DEFAULT_NAME;
+    const char *record_path = NULL;
+    long count = 0;
+    bool quiet = false;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "n:c:qh", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'n':
+                name = optarg;
+                break;
+            case 'c':
+                if (!parse_count(optarg, &count)) {
+                    fprintf(stderr, "Invalid count: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'R':
+                record_path = optarg;
+                break;
+            case 'q':
+                quiet = true;
+                break;
+            case 'h':
+                print_usage(stdout, prog);
+                return 0;
+            default:
+                print_usage(stderr, prog);
+                return 1;
+        }
+    }
+
+    FrameBusReader reader;
+    if (!framebus_open_reader(&reader, name)) {
+        return 1;
+    }
+
+    const FrameBusHeader *h = reader.header;
+    printf("Frame bus %s: %ux%u%s, %u byte frames, %u frame history, writer pid %u%s\n",
+           name,
+           h->width,
+           h->height,
+           h->pixel_order == FRAMEBUS_ORDER_SERPENTINE ? " serpentine" : "",
+           h->frame_size,
+           h->slot_count,
+           h->writer_pid,
+           reader.writable ? "" : " (read-only, polling)");
+
+    FILE *record = NULL;
+    if (record_path) {
+        record = fopen(record_path, "ab");
+        if (!record) {
+            perror(record_path);
+            framebus_close_reader(&reader);
+            return 1;
+        }
+    }
+
+    unsigned char *buf = malloc(h->frame_size);
+    if (!buf) {
+        perror("malloc");
+        framebus_close_reader(&reader);
+        return 1;
+    }
+
+    signal(SIGINT, handle_signal);
+    signal(SIGTERM, handle_signal);
+
+    // Start at the newest frame; older history is not interesting to a
+    // live follower.
+    uint64_t last = framebus_latest_frame_no(&reader);
+    if (last > 0) {
+        last--;
+    }
+
+    long frames = 0;
+    unsigned long long skipped = 0;
+    double publish_to_read_sum_us = 0.0;
+
+    while (!stop_requested && (count == 0 || frames < count)) {
+        uint64_t head = framebus_wait(&reader, last, 500);
+        if (head == 0) {
+            continue;
+        }
+
+        // Catch up through the history ring, oldest first.
+        for (uint64_t n = last + 1; n <= head && !stop_requested; ++n) {
+            FrameBusFrameInfo info;
+            if (!framebus_read_frame(&reader, n, buf, h->frame_size, &info)) {
+                skipped++;
+                continue;
+            }
+            uint64_t read_ns = now_ns();
+
+            if (record && fwrite(buf, 1, info.frame_size, record) != info.frame_size) {
+                perror(record_path);
+                stop_requested = 1;
+            }
+
+            double rx_to_publish = us_between(info.rx_ns, info.publish_ns);
+            double publish_to_read = us_between(info.publish_ns, read_ns);
+            publish_to_read_sum_us += publish_to_read;
+            frames++;
+
+            if (!quiet) {
+                printf("frame %llu: rx->publish %.1f us, publish->read %.1f us\n",
+                       (unsigned long long)info.frame_no,
+                       rx_to_publish,
+                       publish_to_read);
+            }
+            if (count > 0 && frames >= count) {
+                break;
+            }
+        }
+        last = head;
+    }
+
+    printf("Read %ld frames, %llu skipped (overwritten before they were read)", frames, skipped);
+    if (frames > 0) {
+        printf(", mean publish->read %.1f us", publish_to_read_sum_us / (double)frames);
+    }
+    printf("\n");
+
+    free(buf);
+    if (record) {
+        fclose(record);
+    }
+    framebus_close_reader(&reader);
+    return 0;
+}
@@ -0,0 +1,182 @@
+/*
+
+Copyright 2025 Marc Ketel
+SPDX-License-Identifier: Apache-2.0
+
+*/
+
+#include "framepool.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#define HUGE_PAGE_SIZE (2u * 1024u * 1024u)
+
+static_assert(sizeof(FrameSlot) % 64 == 0, "frame slots must stay cache-line aligned");
+static_assert(FRAME_SLOT_SIZE >= MC_EXPECTED_SIZE, "a frame must fit in a slot");
+
+static void *map_arena(size_t len, int extra_flags) {
+    // Populated up front: the first use of a slot should not page-fault.
+    void *mem = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE | extra_flags, -1, 0);
+    return mem == MAP_FAILED ? NULL : mem;
+}
+
+bool frame_pool_init(FramePool *pool, bool huge_pages) {
+    memset(pool, 0, sizeof(*pool));
+    const size_t len = sizeof(FrameSlot) * FRAME_POOL_SLOTS;
+
+#ifdef MAP_HUGETLB
+    if (huge_pages) {
+        pool->arena_len = (len + HUGE_PAGE_SIZE - 1) & ~(size_t)(HUGE_PAGE_SIZE - 1);
+        pool->slots = map_arena(pool->arena_len, MAP_HUGETLB);
+        if (pool->slots) {
+            pool->huge_pages = true;
+        } else {
+            fprintf(stderr, "Warning: no huge pages for the frame pool (see vm.nr_hugepages), continuing with normal pages\n");
+        }
+    }
+#else
+    if (huge_pages) {
+        fprintf(stderr, "Warning: huge pages not supported here, continuing with normal pages\n");
+    }
+#endif
+    if (!pool->slots) {
+        pool->arena_len = len;
+        pool->slots = map_arena(len, 0);
+    }
+    if (!pool->slots) {
+        perror("mmap(frame pool)");
+        return false;
+    }
+
+    // Lowest slots handed out first, so a quiet loop stays on a few lines.
+    for (int i = 0; i < FRAME_POOL_SLOTS; ++i) {
+        pool->free_list[i] = FRAME_POOL_SLOTS - 1 - i;
+    }
+    pool->free_count = FRAME_POOL_SLOTS;
+    pool->min_free = FRAME_POOL_SLOTS;
+    return true;
+}
+
+void frame_pool_free(FramePool *pool) {
+    if (pool->slots) {
+        munmap(pool->slots, pool->arena_len);
+    }
+    memset(pool, 0, sizeof(*pool));
+}
+
+int frame_pool_acquire(FramePool *pool) {
+    if (pool->free_count == 0) {
+        pool->exhausted++;
+        return FRAME_NONE;
+    }
+    const int slot = pool->free_list[--pool->free_count];
+    pool->refs[slot] = 1;
+    pool->acquired++;
+    if (pool->free_count < pool->min_free) {
+        pool->min_free = pool->free_count;
+    }
+    return slot;
+}
+
+void frame_pool_ref(FramePool *pool, int slot) {
+    assert(slot >= 0 && slot < FRAME_POOL_SLOTS && pool->refs[slot] > 0);
+    pool->refs[slot]++;
+}
+
+void frame_pool_unref(FramePool *pool, int slot) {
+    if (slot == FRAME_NONE) {
+        return;
+    }
+    assert(slot >= 0 && slot < FRAME_POOL_SLOTS && pool->refs[slot] > 0);
+    if (--pool->refs[slot] == 0) {
+        pool->free_list[pool->free_count++] = slot;
+    }
+}
+
+int frame_pool_keep(FramePool *pool, int slot, const unsigned char *data, size_t len) {
+    if (slot != FRAME_NONE) {
+        frame_pool_ref(pool, slot);
+        return slot;
+    }
+    slot = frame_pool_acquire(pool);
+    if (slot != FRAME_NONE) {
+        memcpy(frame_pool_data(pool, slot), data, len < FRAME_SLOT_SIZE ? len : FRAME_SLOT_SIZE);
+        pool->copies_in++;
+    }
+    return slot;
+}
+
+void print_frame_pool_summary(const FramePool *pool) {
+    if (!pool->slots) {
+        return;
+    }
+    printf("Frame pool: %d slots of %zu bytes in %.1f KB%s, at most %d in use, %lu acquired, %lu copied in, %lu exhausted\n",
+           FRAME_POOL_SLOTS,
+           sizeof(FrameSlot),
+           pool->arena_len / 1024.0,
+           pool->huge_pages ? " on huge pages" : "",
+           FRAME_POOL_SLOTS - pool->min_free,
+           pool->acquired,
+           pool->copies_in,
+           pool->exhausted);
+#ifdef FRAME_POOL_ALLOC_DEBUG
+    printf("Frame pool: %lu heap allocations on the frame path past warm-up\n", pool->steady_allocations);
+#endif
+    fflush(stdout);
+}
+
+#ifdef FRAME_POOL_ALLOC_DEBUG
+
+// Counting wrappers around glibc's allocator. Only allocations made on the
+// watching thread, between frame_pool_watch_begin() and _end(), count.
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+static _Thread_local bool watching;
+static _Thread_local bool watch_paused;
+static unsigned long watched_allocations;
+
+static inline void count_allocation(void) {
+    if (watching && !watch_paused) {
+        watched_allocations++;
+    }
+}
+
+void *malloc(size_t size) {
+    count_allocation();
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+    count_allocation();
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    count_allocation();
+    return __libc_realloc(ptr, size);
+}
+
+void frame_pool_watch_begin(FramePool *pool) {
+    pool->watch_mark = watched_allocations;
+    watching = true;
+}
+
+void frame_pool_watch_end(FramePool *pool, bool steady) {
+    watching = false;
+    const unsigned long n = watched_allocations - pool->watch_mark;
+    if (steady) {
+        pool->steady_allocations += n;
+        assert(n == 0 && "heap allocation on the steady-state frame path");
+    }
+}
+
+void frame_pool_watch_pause(bool paused) {
+    watch_paused = paused;
+}
+
+#endif // FRAME_POOL_ALLOC_DEBUG
@@ -0,0 +1,100 @@
+/*
+
+Copyright 2025 Marc Ketel
+SPDX-License-Identifier: Apache-2.0
+
+*/
+
+/*
+ * Frame slot pool.
+ *
+ * Every frame buffer the receive loop keeps lives in one arena mapped at
+ * startup, optionally on huge pages: fixed-size slots, each starting on a
+ * cache line, handed around by index with a reference count. The socket
+ * receivers read datagrams straight into a slot. The compositor and the
+ * governor's pending frame take a reference instead of a copy, and a slot
+ * goes back on the free list when its last reference is dropped. Data
+ * from outside the pool (io_uring ring buffers) is copied in once, by
+ * whoever needs to keep it.
+ *
+ * Only the receive loop's thread touches the pool, so reference counts are
+ * plain ints.
+ *
+ * Built with make ALLOC_DEBUG=1, heap allocations on the frame path are
+ * counted, and once past warm-up any allocation fails an assert.
+ */
+
+#ifndef FRAMEPOOL_H
+#define FRAMEPOOL_H
+
+#include "config.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define FRAME_POOL_SLOTS   128 // far more than the loop ever holds at once
+#define FRAME_SLOT_SIZE    MC_BUF_SIZE // a whole datagram, oversized ones included
+#define FRAME_POOL_WARMUP  64 // frames before the allocation watch is strict
+#define FRAME_NONE         (-1)
+
+typedef struct FrameSlot {
+    _Alignas(64) unsigned char data[FRAME_SLOT_SIZE];
+} FrameSlot;
+
+typedef struct FramePool {
+    FrameSlot *slots; // the arena
+    size_t arena_len;
+    bool huge_pages; // arena is on explicit huge pages
+
+    // Kept apart from the slots so counting never touches frame data.
+    int refs[FRAME_POOL_SLOTS];
+    int free_list[FRAME_POOL_SLOTS];
+    int free_count;
+    int min_free; // fewest free slots seen
+
+    unsigned long acquired;
+    unsigned long copies_in; // frames copied in from outside the pool
+    unsigned long exhausted; // acquires that found no free slot
+
+    unsigned long watch_mark;         // allocation count at frame_pool_watch_begin()
+    unsigned long steady_allocations; // past warm-up, ALLOC_DEBUG builds only
+} FramePool;
+
+// huge_pages: try MAP_HUGETLB first, normal pages if none are reserved.
+bool frame_pool_init(FramePool *pool, bool huge_pages);
+void frame_pool_free(FramePool *pool);
+
+// A slot with one reference, FRAME_NONE if all are in use.
+int frame_pool_acquire(FramePool *pool);
+void frame_pool_ref(FramePool *pool, int slot);
+void frame_pool_unref(FramePool *pool, int slot); // FRAME_NONE is ignored
+// Another reference to frame data that may or may not be in slot: a
+// reference if it is, else a copy into a new slot. FRAME_NONE if exhausted.
+int frame_pool_keep(FramePool *pool, int slot, const unsigned char *data, size_t len);
+
+static inline unsigned char *frame_pool_data(FramePool *pool, int slot) {
+    return pool->slots[slot].data;
+}
+
+void print_frame_pool_summary(const FramePool *pool);
+
+// Brackets one pass over the frame path. Pause around calls into SDL,
+// whose allocations are its own business.
+#ifdef FRAME_POOL_ALLOC_DEBUG
+void frame_pool_watch_begin(FramePool *pool);
+void frame_pool_watch_end(FramePool *pool, bool steady);
+void frame_pool_watch_pause(bool paused);
+#else
+static inline void frame_pool_watch_begin(FramePool *pool) {
+    (void)pool;
+}
+static inline void frame_pool_watch_end(FramePool *pool, bool steady) {
+    (void)pool;
+    (void)steady;
+}
+static inline void frame_pool_watch_pause(bool paused) {
+    (void)paused;
+}
+#endif
+
+#endif // FRAMEPOOL_H
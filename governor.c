@@ -0,0 +1,189 @@
+/*
+
+Copyright 2025 Marc Ketel
+SPDX-License-Identifier: Apache-2.0
+
+*/
+
+#include "governor.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define WINDOW_NS              ((uint64_t)GOVERNOR_WINDOW_MS * 1000000ULL)
+#define BACKLOG_NS             ((uint64_t)GOVERNOR_BACKLOG_MS * 1000000ULL)
+#define MAX_RECOVER_WINDOWS    64
+#define COALESCE_QUIET_PERCENT 5 // coalescing more than this many % of frames is not quiet
+
+void governor_init(Governor *g, bool enabled, float refresh_hz, uint64_t now_ns) {
+    memset(g, 0, sizeof(*g));
+    g->enabled = enabled;
+    g->level = GOVERNOR_NORMAL;
+    g->present_interval_ns = (uint64_t)(1e9 / (refresh_hz > 0.0f ? refresh_hz : 60.0f));
+    g->window_start_ns = now_ns;
+    g->level_since_ns = now_ns;
+    g->recover_windows = GOVERNOR_RECOVER_WINDOWS;
+    g->entered[GOVERNOR_NORMAL] = 1;
+}
+
+void governor_frame_arrived(Governor *g, int64_t queued_ns) {
+    g->arrivals++;
+    if (queued_ns >= 0) {
+        g->queued_ns += (uint64_t)queued_ns;
+        g->queued_samples++;
+    }
+}
+
+void governor_frame_coalesced(Governor *g) {
+    g->coalesced++;
+    g->total_coalesced++;
+}
+
+void governor_frame_presented(Governor *g, uint64_t busy_ns, uint64_t now_ns) {
+    g->presents++;
+    g->busy_ns += busy_ns;
+    g->last_present_ns = now_ns;
+}
+
+static void set_level(Governor *g, GovernorLevel level, uint64_t now_ns, double fps_in, double fps_out, double busy, double queued_ms) {
+    printf("Governor: %s -> %s (%.0f fps in, %.0f presented, %.0f%% busy, %.1f ms queued)\n",
+           governor_level_name(g->level),
+           governor_level_name(level),
+           fps_in,
+           fps_out,
+           busy * 100.0,
+           queued_ms);
+    fflush(stdout);
+
+    g->level_ns[g->level] += now_ns - g->level_since_ns;
+    g->level_since_ns = now_ns;
+    g->level = level;
+    g->entered[level]++;
+}
+
+bool governor_update(Governor *g, uint64_t now_ns) {
+    if (!g->enabled || now_ns - g->window_start_ns < WINDOW_NS) {
+        return false;
+    }
+
+    const double seconds = (double)(now_ns - g->window_start_ns) / 1e9;
+    const double busy = (double)g->busy_ns / (double)(now_ns - g->window_start_ns);
+    const uint64_t queued_ns = g->queued_samples > 0 ? g->queued_ns / g->queued_samples : 0;
+    const double fps_in = (double)g->arrivals / seconds;
+    const double fps_out = (double)g->presents / seconds;
+
+    const bool overloaded = queued_ns > BACKLOG_NS || busy > GOVERNOR_BUSY_HIGH;
+    // Coalescing itself hides the backlog, so a level that still drops a
+    // noticeable share of frames is not quiet yet.
+    const bool quiet = queued_ns < BACKLOG_NS / 2 && busy < GOVERNOR_BUSY_LOW &&
+                       g->coalesced * 100 <= g->arrivals * COALESCE_QUIET_PERCENT;
+
+    bool changed = false;
+    if (overloaded) {
+        g->quiet_windows = 0;
+        if (g->level + 1 < GOVERNOR_LEVELS) {
+            // Overloaded right after stepping down: that level was too
+            // optimistic, wait longer before trying it again.
+            if (g->recovered_last && g->recover_windows < MAX_RECOVER_WINDOWS) {
+                g->recover_windows *= 2;
+            }
+            g->recovered_last = false;
+            set_level(g, g->level + 1, now_ns, fps_in, fps_out, busy, (double)queued_ns / 1e6);
+            changed = true;
+        }
+    } else if (quiet && g->level > GOVERNOR_NORMAL) {
+        if (++g->quiet_windows >= g->recover_windows) {
+            g->quiet_windows = 0;
+            g->recovered_last = true;
+            set_level(g, g->level - 1, now_ns, fps_in, fps_out, busy, (double)queued_ns / 1e6);
+            if (g->level == GOVERNOR_NORMAL) {
+                g->recover_windows = GOVERNOR_RECOVER_WINDOWS;
+            }
+            changed = true;
+        }
+    } else {
+        g->quiet_windows = 0;
+        g->recovered_last = false;
+    }
+
+    g->window_start_ns = now_ns;
+    g->arrivals = 0;
+    g->presents = 0;
+    g->coalesced = 0;
+    g->busy_ns = 0;
+    g->queued_ns = 0;
+    g->queued_samples = 0;
+    return changed;
+}
+
+bool governor_coalescing(const Governor *g) {
+    return g->level >= GOVERNOR_COALESCE;
+}
+
+bool governor_lean(const Governor *g) {
+    return g->level >= GOVERNOR_LEAN;
+}
+
+bool governor_cheap_path(const Governor *g) {
+    return g->level >= GOVERNOR_CHEAP_PATH;
+}
+
+bool governor_present_due(const Governor *g, uint64_t now_ns) {
+    return g->level < GOVERNOR_CAP_PRESENTS || now_ns - g->last_present_ns >= g->present_interval_ns;
+}
+
+const char *governor_level_name(GovernorLevel level) {
+    switch (level) {
+        case GOVERNOR_NORMAL:
+            return "normal";
+        case GOVERNOR_COALESCE:
+            return "coalesce";
+        case GOVERNOR_LEAN:
+            return "lean";
+        case GOVERNOR_CHEAP_PATH:
+            return "cheap path";
+        case GOVERNOR_CAP_PRESENTS:
+            return "capped presents";
+        case GOVERNOR_LEVELS:
+            break;
+    }
+    return "unknown";
+}
+
+const char *governor_level_label(const Governor *g) {
+    return g->enabled ? governor_level_name(g->level) : NULL;
+}
+
+unsigned long governor_coalesced(const Governor *g) {
+    return g->total_coalesced;
+}
+
+void print_governor_summary(Governor *g, uint64_t now_ns) {
+    if (!g->enabled) {
+        return;
+    }
+    g->level_ns[g->level] += now_ns - g->level_since_ns;
+    g->level_since_ns = now_ns;
+
+    uint64_t total = 0;
+    for (int i = 0; i < GOVERNOR_LEVELS; ++i) {
+        total += g->level_ns[i];
+    }
+    if (total == 0) {
+        return;
+    }
+
+    printf("Governor: %lu frames coalesced; time per level:", g->total_coalesced);
+    for (int i = 0; i < GOVERNOR_LEVELS; ++i) {
+        if (g->entered[i] == 0) {
+            continue;
+        }
+        printf(" %s %.1f s (%.1f%%, entered %lux)",
+               governor_level_name((GovernorLevel)i),
+               (double)g->level_ns[i] / 1e9,
+               100.0 * (double)g->level_ns[i] / (double)total,
+               g->entered[i]);
+    }
+    printf("\n");
+    fflush(stdout);
+}
@@ -0,0 +1,97 @@
+/*
+
+Copyright 2025 Marc Ketel
+SPDX-License-Identifier: Apache-2.0
+
+*/
+
+/*
+ * Overload governor.
+ *
+ * Compares what arrives with what the outputs keep up with, in windows of
+ * GOVERNOR_WINDOW_MS: how long frames waited before the loop picked them
+ * up, and how much of the window went into presenting. When the loop falls
+ * behind it steps up one level per window; each level keeps the ones below:
+ *
+ *   coalesce     drain everything queued, present only the newest frame
+ *   lean         also skip window title and layout work per frame
+ *   cheap path   also switch from the renderer to the surface path
+ *   cap presents also present at most once per display refresh
+ *
+ * It steps back down one level after GOVERNOR_RECOVER_WINDOWS quiet windows
+ * in a row; falling straight back into overload doubles that wait, so a
+ * load right at a level's edge does not flap.
+ */
+
+#ifndef GOVERNOR_H
+#define GOVERNOR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define GOVERNOR_WINDOW_MS       500
+#define GOVERNOR_BACKLOG_MS      50   // mean wait before pickup that counts as falling behind
+#define GOVERNOR_BUSY_HIGH       0.75 // share of the window spent presenting that counts as overload
+#define GOVERNOR_BUSY_LOW        0.35 // ... and that is low enough to step down
+#define GOVERNOR_RECOVER_WINDOWS 4
+#define GOVERNOR_MAX_DRAIN       256 // frames drained per loop iteration while coalescing
+
+typedef enum GovernorLevel {
+    GOVERNOR_NORMAL,
+    GOVERNOR_COALESCE,
+    GOVERNOR_LEAN,
+    GOVERNOR_CHEAP_PATH,
+    GOVERNOR_CAP_PRESENTS,
+    GOVERNOR_LEVELS,
+} GovernorLevel;
+
+typedef struct Governor {
+    bool enabled;
+    GovernorLevel level;
+    uint64_t present_interval_ns; // display refresh interval, for GOVERNOR_CAP_PRESENTS
+
+    // Current window.
+    uint64_t window_start_ns;
+    unsigned long arrivals;
+    unsigned long presents;
+    unsigned long coalesced;
+    uint64_t busy_ns;
+    uint64_t queued_ns;
+    unsigned long queued_samples;
+
+    int quiet_windows;
+    int recover_windows; // quiet windows needed to step down, doubles on flapping
+    bool recovered_last; // the last transition was a step down
+    uint64_t last_present_ns;
+
+    // Totals, for the exit summary.
+    uint64_t level_since_ns;
+    uint64_t level_ns[GOVERNOR_LEVELS];
+    unsigned long entered[GOVERNOR_LEVELS];
+    unsigned long total_coalesced;
+} Governor;
+
+// refresh_hz <= 0: assume 60 Hz for the present cap.
+void governor_init(Governor *g, bool enabled, float refresh_hz, uint64_t now_ns);
+
+// A frame arrived; queued_ns is how long it waited for the loop, < 0 if unknown.
+void governor_frame_arrived(Governor *g, int64_t queued_ns);
+// A frame was replaced by a newer one before it was presented.
+void governor_frame_coalesced(Governor *g);
+void governor_frame_presented(Governor *g, uint64_t busy_ns, uint64_t now_ns);
+
+// Ends the window when it is due; true if the level changed.
+bool governor_update(Governor *g, uint64_t now_ns);
+
+bool governor_coalescing(const Governor *g);
+bool governor_lean(const Governor *g);
+bool governor_cheap_path(const Governor *g);
+bool governor_present_due(const Governor *g, uint64_t now_ns);
+
+const char *governor_level_name(GovernorLevel level);
+// Name of the current level, NULL while the governor is off.
+const char *governor_level_label(const Governor *g);
+unsigned long governor_coalesced(const Governor *g); // since startup
+void print_governor_summary(Governor *g, uint64_t now_ns);
+
+#endif // GOVERNOR_H
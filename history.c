@@ -0,0 +1,379 @@
+/*
+
+Copyright 2025 Marc Ketel
+SPDX-License-Identifier: Apache-2.0
+
+*/
+
+#include "history.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+    HISTORY_KEY = 1,   // payload is the full frame
+    HISTORY_DELTA = 2, // payload is the RLE'd XOR against the previous frame
+};
+
+// Record header in the arena; the payload follows it.
+typedef struct HistoryRecord {
+    uint64_t seq;
+    uint64_t first_ns; // receive time of the frame (CLOCK_REALTIME ns)
+    uint64_t last_ns;  // receive time of its last repeat
+    uint32_t prev;     // offset of the previous record, if seq - 1 is still present
+    uint32_t size;     // header + payload, rounded up to 8 bytes
+    uint32_t repeats;
+    uint16_t payload_len;
+    uint8_t type;
+    uint8_t reserved;
+} HistoryRecord;
+
+static_assert(sizeof(HistoryRecord) % 8 == 0, "records must stay 8-byte aligned");
+
+#define RUN_MAX 128
+
+static HistoryRecord *record_at(const History *h, uint32_t offset) {
+    return (HistoryRecord *)(h->arena + offset);
+}
+
+static uint32_t record_size(size_t payload_len) {
+    return (uint32_t)((sizeof(HistoryRecord) + payload_len + 7) & ~(size_t)7);
+}
+
+// Delta tokens: 0x00-0x7F skip 1-128 unchanged bytes, 0x80-0xFF are
+// followed by 1-128 bytes to XOR in. A trailing unchanged run is left out.
+// out must hold MC_EXPECTED_SIZE bytes. Returns 0 if the delta would not
+// be smaller than the frame itself.
+static size_t encode_delta(const unsigned char *base, const unsigned char *frame, unsigned char *out) {
+    size_t o = 0;
+    size_t i = 0;
+    while (i < MC_EXPECTED_SIZE) {
+        size_t run = 0;
+        while (i + run < MC_EXPECTED_SIZE && run < RUN_MAX && base[i + run] == frame[i + run]) {
+            run++;
+        }
+        if (run > 0) {
+            if (i + run == MC_EXPECTED_SIZE) {
+                break;
+            }
+            if (o + 1 >= MC_EXPECTED_SIZE) {
+                return 0;
+            }
+            out[o++] = (unsigned char)(run - 1);
+            i += run;
+            continue;
+        }
+
+        while (i + run < MC_EXPECTED_SIZE && run < RUN_MAX && base[i + run] != frame[i + run]) {
+            run++;
+        }
+        if (o + 1 + run >= MC_EXPECTED_SIZE) {
+            return 0;
+        }
+        out[o++] = (unsigned char)(0x80 | (run - 1));
+        for (size_t k = 0; k < run; ++k) {
+            out[o++] = base[i + k] ^ frame[i + k];
+        }
+        i += run;
+    }
+    return o;
+}
+
+static void apply_delta(unsigned char *frame, const unsigned char *delta, size_t len) {
+    size_t i = 0;
+    size_t d = 0;
+    while (d < len && i < MC_EXPECTED_SIZE) {
+        unsigned char token = delta[d++];
+        size_t run = (size_t)(token & 0x7F) + 1;
+        if (token & 0x80) {
+            for (size_t k = 0; k < run && i < MC_EXPECTED_SIZE && d < len; ++k) {
+                frame[i++] ^= delta[d++];
+            }
+        } else {
+            i += run;
+        }
+    }
+}
+
+bool history_init(History *h, int minutes, int arena_mb) {
+    memset(h, 0, sizeof(*h));
+    h->next_seq = 1;
+    if (minutes <= 0 || arena_mb <= 0) {
+        return false;
+    }
+
+    h->capacity = (uint32_t)arena_mb * 1024u * 1024u;
+    h->arena = malloc(h->capacity);
+    if (!h->arena) {
+        fprintf(stderr, "Warning: cannot allocate %d MB for the rewind history, history disabled\n", arena_mb);
+        h->capacity = 0;
+        return false;
+    }
+    h->max_age_ns = (uint64_t)minutes * 60ULL * 1000000000ULL;
+
+    printf("Rewind history: last %d min, %d MB arena\n", minutes, arena_mb);
+    return true;
+}
+
+bool history_enabled(const History *h) {
+    return h->arena != NULL;
+}
+
+uint64_t history_oldest_seq(const History *h) {
+    return h->count ? record_at(h, h->tail)->seq : 0;
+}
+
+uint64_t history_newest_seq(const History *h) {
+    return h->count ? h->next_seq - 1 : 0;
+}
+
+static uint32_t next_offset(const History *h, uint32_t offset) {
+    uint32_t next = offset + record_at(h, offset)->size;
+    if (h->wrapped && next == h->wrap_end) {
+        return 0;
+    }
+    return next;
+}
+
+static void drop_one(History *h) {
+    uint32_t next = next_offset(h, h->tail);
+    if (next == 0 && h->wrapped) {
+        h->wrapped = false;
+    }
+    h->tail = next;
+    h->count--;
+    if (h->count == 0) {
+        h->head = 0;
+        h->tail = 0;
+        h->wrapped = false;
+    }
+}
+
+// Drops the oldest record, then any deltas whose base went with it.
+static void drop_oldest(History *h) {
+    drop_one(h);
+    while (h->count > 0 && record_at(h, h->tail)->type != HISTORY_KEY) {
+        drop_one(h);
+    }
+}
+
+// Finds room for size bytes at head, dropping the oldest records as needed.
+static uint32_t reserve(History *h, uint32_t size) {
+    for (;;) {
+        if (!h->wrapped) {
+            if (h->capacity - h->head >= size) {
+                return h->head;
+            }
+            h->wrap_end = h->head;
+            h->head = 0;
+            h->wrapped = h->count > 0;
+            continue;
+        }
+        if (h->tail - h->head >= size) {
+            return h->head;
+        }
+        drop_oldest(h);
+    }
+}
+
+void history_append(History *h, const unsigned char *frame, uint64_t rx_ns) {
+    if (!h->arena) {
+        return;
+    }
+    h->frames++;
+
+    while (h->count > 0 && record_at(h, h->tail)->last_ns + h->max_age_ns < rx_ns) {
+        drop_oldest(h);
+    }
+
+    // A repeat of the previous frame only extends its record.
+    if (h->count > 0 && memcmp(frame, h->last_frame, MC_EXPECTED_SIZE) == 0) {
+        HistoryRecord *rec = record_at(h, h->newest);
+        rec->repeats++;
+        rec->last_ns = rx_ns;
+        return;
+    }
+
+    unsigned char delta[MC_EXPECTED_SIZE];
+    size_t delta_len = 0;
+    if (h->count > 0 && h->since_key < HISTORY_KEY_INTERVAL - 1) {
+        delta_len = encode_delta(h->last_frame, frame, delta);
+    }
+
+    uint8_t type = delta_len > 0 ? HISTORY_DELTA : HISTORY_KEY;
+    size_t payload_len = type == HISTORY_DELTA ? delta_len : MC_EXPECTED_SIZE;
+    uint32_t offset = reserve(h, record_size(payload_len));
+
+    // Making room may have dropped the delta's base along with everything
+    // else; start over with a full frame then.
+    if (h->count == 0 && type == HISTORY_DELTA) {
+        type = HISTORY_KEY;
+        payload_len = MC_EXPECTED_SIZE;
+        offset = reserve(h, record_size(payload_len));
+    }
+
+    HistoryRecord *rec = record_at(h, offset);
+    rec->seq = h->next_seq++;
+    rec->first_ns = rx_ns;
+    rec->last_ns = rx_ns;
+    rec->prev = h->newest;
+    rec->size = record_size(payload_len);
+    rec->repeats = 1;
+    rec->payload_len = (uint16_t)payload_len;
+    rec->type = type;
+    rec->reserved = 0;
+    memcpy(rec + 1, type == HISTORY_DELTA ? delta : frame, payload_len);
+
+    if (h->count == 0) {
+        h->tail = offset;
+    }
+    h->head = offset + rec->size;
+    h->newest = offset;
+    h->count++;
+    h->stored_bytes += rec->size;
+    h->since_key = type == HISTORY_KEY ? 0 : h->since_key + 1;
+    memcpy(h->last_frame, frame, MC_EXPECTED_SIZE);
+}
+
+static bool cursor_valid(const History *h, const HistoryCursor *c) {
+    return c->seq != 0 && h->count > 0 && c->seq >= history_oldest_seq(h) && c->seq <= history_newest_seq(h);
+}
+
+// Offset of record seq (which must be present), walking from whichever
+// known record is closest: the oldest, the newest or the cursor.
+static uint32_t locate(const History *h, const HistoryCursor *c, uint64_t seq) {
+    uint64_t oldest = history_oldest_seq(h);
+    uint64_t newest = history_newest_seq(h);
+
+    uint32_t offset = h->newest;
+    uint64_t at = newest;
+    if (seq - oldest < newest - seq) {
+        offset = h->tail;
+        at = oldest;
+    }
+    if (cursor_valid(h, c)) {
+        uint64_t dist = c->seq > seq ? c->seq - seq : seq - c->seq;
+        uint64_t best = at > seq ? at - seq : seq - at;
+        if (dist < best) {
+            offset = c->offset;
+            at = c->seq;
+        }
+    }
+
+    while (at > seq) {
+        offset = record_at(h, offset)->prev;
+        at--;
+    }
+    while (at < seq) {
+        offset = next_offset(h, offset);
+        at++;
+    }
+    return offset;
+}
+
+static void rebuild(const History *h, HistoryCursor *c, uint32_t offset) {
+    const HistoryRecord *target = record_at(h, offset);
+
+    if (cursor_valid(h, c) && target->seq == c->seq + 1) {
+        // Stepping forward: one delta on top of the frame already there.
+        if (target->type == HISTORY_KEY) {
+            memcpy(c->frame, target + 1, MC_EXPECTED_SIZE);
+        } else {
+            apply_delta(c->frame, (const unsigned char *)(target + 1), target->payload_len);
+        }
+    } else if (!cursor_valid(h, c) || target->seq != c->seq) {
+        // Back to the closest full frame, then forward through the deltas.
+        uint32_t key = offset;
+        while (record_at(h, key)->type != HISTORY_KEY) {
+            key = record_at(h, key)->prev;
+        }
+        memcpy(c->frame, record_at(h, key) + 1, MC_EXPECTED_SIZE);
+        while (key != offset) {
+            key = next_offset(h, key);
+            const HistoryRecord *rec = record_at(h, key);
+            apply_delta(c->frame, (const unsigned char *)(rec + 1), rec->payload_len);
+        }
+    }
+
+    c->seq = target->seq;
+    c->offset = offset;
+    c->first_ns = target->first_ns;
+    c->last_ns = target->last_ns;
+    c->repeats = target->repeats;
+}
+
+bool history_seek(const History *h, HistoryCursor *c, uint64_t seq) {
+    if (h->count == 0) {
+        return false;
+    }
+
+    uint64_t oldest = history_oldest_seq(h);
+    uint64_t newest = history_newest_seq(h);
+    if (seq < oldest) {
+        seq = oldest;
+    } else if (seq > newest) {
+        seq = newest;
+    }
+
+    rebuild(h, c, locate(h, c, seq));
+    return true;
+}
+
+bool history_seek_time(const History *h, HistoryCursor *c, uint64_t ns) {
+    if (h->count == 0) {
+        return false;
+    }
+
+    // Walk the headers only, then rebuild the frame once.
+    uint64_t oldest = history_oldest_seq(h);
+    uint64_t newest = history_newest_seq(h);
+    uint64_t seq = cursor_valid(h, c) ? c->seq : newest;
+    uint32_t offset = cursor_valid(h, c) ? c->offset : h->newest;
+
+    while (seq > oldest && record_at(h, offset)->first_ns > ns) {
+        offset = record_at(h, offset)->prev;
+        seq--;
+    }
+    while (seq < newest) {
+        uint32_t next = next_offset(h, offset);
+        if (record_at(h, next)->first_ns > ns) {
+            break;
+        }
+        offset = next;
+        seq++;
+    }
+
+    rebuild(h, c, offset);
+    return true;
+}
+
+void print_history_summary(const History *h) {
+    if (!h->arena) {
+        return;
+    }
+
+    double span = 0.0;
+    unsigned long long used = 0;
+    if (h->count > 0) {
+        span = (double)(record_at(h, h->newest)->last_ns - record_at(h, h->tail)->first_ns) / 1e9;
+        used = h->wrapped ? (unsigned long long)(h->wrap_end - h->tail) + h->head : h->head - h->tail;
+    }
+
+    printf("Rewind history: %llu frames stored as %llu bytes (%.1f bytes/frame), %llu records kept, "
+           "%.1f s in %.1f of %.1f MB\n",
+           h->frames,
+           h->stored_bytes,
+           h->frames > 0 ? (double)h->stored_bytes / (double)h->frames : 0.0,
+           (unsigned long long)h->count,
+           span,
+           used / (1024.0 * 1024.0),
+           h->capacity / (1024.0 * 1024.0));
+    fflush(stdout);
+}
+
+void history_free(History *h) {
+    free(h->arena);
+    memset(h, 0, sizeof(*h));
+}
@@ -0,0 +1,81 @@
+/*
+
+Copyright 2025 Marc Ketel
+SPDX-License-Identifier: Apache-2.0
+
+*/
+
+/*
+ * Rewind history of received frames.
+ *
+ * Frames are appended to a circular log inside one arena allocated at
+ * startup, so recording never allocates. A frame identical to the one
+ * before it only bumps the previous record's repeat count. Any other frame
+ * is stored as a delta against the previous frame: the XOR of the two,
+ * run-length encoded, so unchanged bytes cost almost nothing. Every
+ * HISTORY_KEY_INTERVAL records (or when a delta would not be smaller) the
+ * full frame is stored instead, so a frame never needs more than
+ * HISTORY_KEY_INTERVAL deltas to rebuild.
+ *
+ * The oldest records are dropped once they are older than the configured
+ * duration or the arena is full; the log always starts at a full frame.
+ */
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include "config.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define HISTORY_KEY_INTERVAL 64
+
+typedef struct History {
+    unsigned char *arena;
+    uint32_t capacity;
+    uint64_t max_age_ns; // drop records older than this
+
+    uint32_t head;     // where the next record goes
+    uint32_t tail;     // oldest record, always a full frame
+    uint32_t wrap_end; // end of the data before head wrapped to 0
+    bool wrapped;      // records run from tail to wrap_end, then from 0 to head
+    uint32_t newest;   // offset of the newest record
+    uint64_t count;    // records in the log
+    uint64_t next_seq; // sequence number of the next record, starts at 1
+
+    unsigned char last_frame[MC_EXPECTED_SIZE]; // delta base for the next record
+    int since_key;                              // records since the last full frame
+
+    // Totals, for the exit summary.
+    unsigned long long frames;
+    unsigned long long stored_bytes;
+} History;
+
+// A position in the history and the frame rebuilt there.
+typedef struct HistoryCursor {
+    uint64_t seq; // record shown, 0 = none
+    uint32_t offset;
+    uint64_t first_ns; // receive time of the frame (CLOCK_REALTIME ns)
+    uint64_t last_ns;  // receive time of its last repeat
+    uint32_t repeats;  // identical frames collapsed into this record
+    unsigned char frame[MC_EXPECTED_SIZE];
+} HistoryCursor;
+
+bool history_init(History *h, int minutes, int arena_mb);
+bool history_enabled(const History *h);
+void history_append(History *h, const unsigned char *frame, uint64_t rx_ns);
+
+uint64_t history_oldest_seq(const History *h);
+uint64_t history_newest_seq(const History *h);
+
+// Move the cursor and rebuild its frame. Targets outside the history are
+// clamped to it; false if the history is empty.
+bool history_seek(const History *h, HistoryCursor *c, uint64_t seq);
+bool history_seek_time(const History *h, HistoryCursor *c, uint64_t ns);
+
+void print_history_summary(const History *h);
+void history_free(History *h);
+
+#endif // HISTORY_H
@@ -0,0 +1,51 @@
+/*
+
+Copyright 2025 Marc Ketel
+SPDX-License-Identifier: Apache-2.0
+
+*/
+
+#define _GNU_SOURCE
+
+#include "lowlatency.h"
+
+#include <sched.h>
+#include <stdio.h>
+#include <sys/mman.h>
+
+void apply_low_latency_settings(const AppConfig *config) {
+    // pid 0 means the calling thread, so threads SDL already started keep
+    // their own affinity and policy; only the receive loop is affected.
+    if (config->cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(config->cpu, &set);
+        if (sched_setaffinity(0, sizeof(set), &set) < 0) {
+            perror("sched_setaffinity");
+        } else {
+            printf("Receive loop pinned to CPU %d\n", config->cpu);
+        }
+    }
+
+    if (config->rt_priority > 0) {
+        if (config->busy_poll && config->cpu < 0) {
+            fprintf(stderr, "Warning: busy polling under SCHED_FIFO without --cpu can starve other tasks on that CPU\n");
+        }
+
+        struct sched_param param = {0};
+        param.sched_priority = config->rt_priority;
+        if (sched_setscheduler(0, SCHED_FIFO, &param) < 0) {
+            perror("sched_setscheduler(SCHED_FIFO)");
+        } else {
+            printf("Receive loop running SCHED_FIFO priority %d\n", config->rt_priority);
+        }
+    }
+
+    if (config->lock_memory) {
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0) {
+            perror("mlockall");
+        } else {
+            printf("Memory locked (mlockall)\n");
+        }
+    }
+}
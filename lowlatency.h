@@ -0,0 +1,17 @@
+/*
+
+Copyright 2025 Marc Ketel
+SPDX-License-Identifier: Apache-2.0
+
+*/
+
+#ifndef LOWLATENCY_H
+#define LOWLATENCY_H
+
+#include "config.h"
+
+// Applies CPU pinning, SCHED_FIFO and mlockall() to the calling thread as
+// configured. Failures are reported and skipped, never fatal.
+void apply_low_latency_settings(const AppConfig *config);
+
+#endif // LOWLATENCY_H
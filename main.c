@@ -5,91 +5,434 @@ SPDX-License-Identifier: Apache-2.0
 
 */
 
+#include "compositor.h"
 #include "config.h"
 #include "display.h"
 #include "events.h"
+#include "framebus.h"
+#include "framepool.h"
+#include "governor.h"
+#include "history.h"
+#include "lowlatency.h"
+#include "merge.h"
 #include "multicast.h"
+#include "options.h"
+#include "receiver.h"
+#include "remap.h"
 #include "stats.h"
+#include "timeutil.h"
 
 #include <SDL3/SDL.h>
 #include <stdbool.h>
 #include <stdio.h>
-#include <sys/select.h>
-#include <sys/socket.h>
-#include <sys/time.h>
-#include <sys/types.h>
-#include <unistd.h>
+#include <time.h>
 
-#define MC_BUF_SIZE 2048
+// In busy-poll mode SDL events are still handled, but only this often.
+#define BUSY_POLL_EVENT_INTERVAL_NS 1000000ULL
 
-static void
-receive_and_render_loop(SDL_Renderer *renderer, int mc_sock) {
+// What is on screen while the history is being browsed. Frames keep being
+// received, recorded and published; they are just not shown.
+typedef struct Rewind {
+    bool paused;
+    HistoryCursor cursor;
+} Rewind;
+
+static void show_history_frame(Display *display, const History *history, const Rewind *rewind) {
+    const HistoryCursor *c = &rewind->cursor;
+    const uint64_t oldest = history_oldest_seq(history);
+    const uint64_t now = realtime_ns();
+
+    char status[64];
+    SDL_snprintf(status,
+                 sizeof(status),
+                 "PAUSED -%.1f s, frame %llu of %llu",
+                 now > c->first_ns ? (double)(now - c->first_ns) / 1e9 : 0.0,
+                 (unsigned long long)(c->seq - oldest + 1),
+                 (unsigned long long)(history_newest_seq(history) - oldest + 1));
+    display_set_status(display, status);
+    display_frame(display, c->frame, sizeof(c->frame));
+}
+
+static void go_live(Display *display, const History *history, Rewind *rewind) {
+    rewind->paused = false;
+    display_set_status(display, NULL);
+    // Show the newest frame now rather than at the next one to arrive.
+    if (history_seek(history, &rewind->cursor, history_newest_seq(history))) {
+        display_frame(display, rewind->cursor.frame, sizeof(rewind->cursor.frame));
+    }
+}
+
+static void handle_rewind_keys(Display *display, const History *history, Rewind *rewind, const InputActions *actions) {
+    if (!history_enabled(history)) {
+        return;
+    }
+
+    if (actions->go_live || (actions->toggle_pause && rewind->paused)) {
+        if (rewind->paused) {
+            go_live(display, history, rewind);
+        }
+        return;
+    }
+
+    const bool moves = actions->step != 0 || actions->scrub_seconds != 0 || actions->jump_oldest;
+    if (!actions->toggle_pause && !moves) {
+        return;
+    }
+
+    // Any navigation key pauses first, at the newest frame.
+    if (!rewind->paused) {
+        if (!history_seek(history, &rewind->cursor, history_newest_seq(history))) {
+            return;
+        }
+        rewind->paused = true;
+    }
+
+    HistoryCursor *c = &rewind->cursor;
+    if (actions->jump_oldest) {
+        history_seek(history, c, history_oldest_seq(history));
+    }
+    if (actions->step != 0) {
+        // history_seek() clamps; only keep the target from going below 1.
+        int64_t target = (int64_t)c->seq + actions->step;
+        history_seek(history, c, target > 0 ? (uint64_t)target : 1);
+    }
+    if (actions->scrub_seconds != 0) {
+        int64_t target = (int64_t)c->first_ns + (int64_t)actions->scrub_seconds * 1000000000LL;
+        history_seek_time(history, c, target > 0 ? (uint64_t)target : 0);
+    }
+    show_history_frame(display, history, rewind);
+}
+
+// The frame bus is the headless output: with --remap it carries the target
+// geometry in its own pixel order, through its own table.
+typedef struct BusOutput {
+    FrameBusWriter writer;
+    bool remapped;
+    RemapTable remap;
+    unsigned char frame[REMAP_MAX_FRAME_SIZE];
+} BusOutput;
+
+// Publish first: local consumers should not wait for the present, which
+// can block on vsync.
+static void present_frame(Display *display, BusOutput *bus, const Rewind *rewind, const unsigned char *frame, const struct timespec *rx_ts) {
+    if (bus->remapped) {
+        remap_apply(&bus->remap, frame, bus->frame);
+        framebus_publish(&bus->writer, bus->frame, remap_frame_size(&bus->remap), rx_ts);
+    } else {
+        framebus_publish(&bus->writer, frame, MC_EXPECTED_SIZE, rx_ts);
+    }
+    if (!rewind->paused) {
+        frame_pool_watch_pause(true);
+        display_frame(display, frame, MC_EXPECTED_SIZE);
+        frame_pool_watch_pause(false);
+    }
+}
+
+// Newest output frame not presented yet, while the governor coalesces.
+typedef struct PendingFrame {
+    int frame; // pool slot, FRAME_NONE = nothing pending
+    bool have_rx_ts;
+    struct timespec rx_ts;
+    struct timespec picked_ts;
+} PendingFrame;
+
+typedef struct Outputs {
+    FramePool *pool;
+    Display *display;
+    BusOutput *bus;
+    Governor *governor;
+    StatsState *stats;
+    Rewind rewind;
+    PendingFrame pending;
+} Outputs;
+
+// picked_ts: when the loop took the frame in, NULL if not from the stream.
+static void output_frame(Outputs *o, const unsigned char *frame, const struct timespec *rx_ts, const struct timespec *picked_ts) {
+    const Uint64 start_ns = SDL_GetTicksNS();
+    present_frame(o->display, o->bus, &o->rewind, frame, rx_ts);
+    const Uint64 end_ns = SDL_GetTicksNS();
+    governor_frame_presented(o->governor, end_ns - start_ns, end_ns);
+
+    if (rx_ts && picked_ts && !o->rewind.paused) {
+        struct timespec shown_ts;
+        clock_gettime(CLOCK_REALTIME, &shown_ts);
+        stats_record_latency(o->stats, rx_ts, picked_ts, &shown_ts);
+    }
+}
+
+static void drop_pending(Outputs *o) {
+    if (o->pending.frame != FRAME_NONE) {
+        governor_frame_coalesced(o->governor);
+        frame_pool_unref(o->pool, o->pending.frame);
+        o->pending.frame = FRAME_NONE;
+    }
+}
+
+// Presents a frame right away, or while coalescing keeps it as the one to
+// present once the queue is drained, replacing any older one. pool_slot is
+// the slot holding frame, if it is in the pool.
+static void offer_frame(Outputs *o, const unsigned char *frame, int pool_slot, const struct timespec *rx_ts, const struct timespec *picked_ts) {
+    if (!governor_coalescing(o->governor)) {
+        output_frame(o, frame, rx_ts, picked_ts);
+        return;
+    }
+
+    drop_pending(o);
+    PendingFrame *p = &o->pending;
+    p->frame = frame_pool_keep(o->pool, pool_slot, frame, MC_EXPECTED_SIZE);
+    if (p->frame == FRAME_NONE) {
+        // Pool exhausted: better late than never.
+        output_frame(o, frame, rx_ts, picked_ts);
+        return;
+    }
+    p->have_rx_ts = rx_ts && picked_ts;
+    if (p->have_rx_ts) {
+        p->rx_ts = *rx_ts;
+        p->picked_ts = *picked_ts;
+    }
+}
+
+static void flush_pending(Outputs *o) {
+    PendingFrame *p = &o->pending;
+    if (p->frame == FRAME_NONE || !governor_present_due(o->governor, SDL_GetTicksNS())) {
+        return;
+    }
+    output_frame(o, frame_pool_data(o->pool, p->frame), p->have_rx_ts ? &p->rx_ts : NULL, p->have_rx_ts ? &p->picked_ts : NULL);
+    frame_pool_unref(o->pool, p->frame);
+    p->frame = FRAME_NONE;
+}
+
+static void receive_and_render_loop(
+    FramePool *pool, Display *display, MergeReceiver *rx, Compositor *compositor, BusOutput *bus, History *history, Governor *governor) {
     bool running = true;
-    unsigned char mc_buf[MC_BUF_SIZE];
     StatsState stats = {0};
+    Uint64 last_events_ns = 0;
+    // Static: the rewind cursor holds a whole frame.
+    static Outputs out;
+    out.pool = pool;
+    out.pending.frame = FRAME_NONE;
+    out.display = display;
+    out.bus = bus;
+    out.governor = governor;
+    out.stats = &stats;
 
     while (running) {
-        if (!handle_sdl_events(&running)) {
-            break;
+        if (!rx->busy_poll || SDL_GetTicksNS() - last_events_ns >= BUSY_POLL_EVENT_INTERVAL_NS) {
+            InputActions actions;
+            if (!handle_sdl_events(&running, &actions)) {
+                break;
+            }
+            last_events_ns = SDL_GetTicksNS();
+
+            if (actions.next_color_profile) {
+                color_lut_next(&display->lut);
+            }
+            handle_rewind_keys(display, history, &out.rewind, &actions);
+            display_refresh(display);
+        }
+
+        // From here to the governor, frames only move between pool slots.
+        frame_pool_watch_begin(pool);
+
+        // Coalescing drains whatever queued up behind a slow present; every
+        // frame still reaches the compositor, history and statistics.
+        const int drain = governor_coalescing(governor) ? GOVERNOR_MAX_DRAIN : 1;
+        ReceivedFrame frame;
+        for (int n = 0; n < drain && merge_poll(rx, &frame); ++n) {
+            struct timespec picked_ts;
+            clock_gettime(CLOCK_REALTIME, &picked_ts);
+            const uint64_t picked_ns = timespec_to_ns(&picked_ts);
+            const uint64_t rx_ns = frame.have_rx_ts ? timespec_to_ns(&frame.rx_ts) : picked_ns;
+            governor_frame_arrived(governor, frame.have_rx_ts ? (int64_t)(picked_ns - rx_ns) : -1);
+
+            const unsigned char *shown = NULL;
+            int shown_slot = FRAME_NONE;
+            if (frame.len == MC_EXPECTED_SIZE) {
+                shown = frame.data;
+                shown_slot = frame.pool_slot;
+                if (compositor_active(compositor)) {
+                    compositor_submit(compositor, &frame, rx_ns);
+                    shown_slot = compositor_compose(compositor); // FRAME_NONE: nothing visible changed
+                    shown = shown_slot != FRAME_NONE ? frame_pool_data(pool, shown_slot) : NULL;
+                }
+                if (shown) {
+                    offer_frame(&out, shown, shown_slot, frame.have_rx_ts ? &frame.rx_ts : NULL, &picked_ts);
+                }
+            } else {
+                fprintf(stderr,
+                        "Warning: received unexpected frame size: %zu bytes (expected %d), frame ignored\n",
+                        frame.len,
+                        MC_EXPECTED_SIZE);
+            }
+
+            // Recorded and logged after rendering so neither is on the
+            // frame's critical path. A frame that changed nothing visible is
+            // recorded as a repeat of the current composition, so stepping
+            // through the history still goes frame by frame.
+            const unsigned char *recorded = shown;
+            if (!recorded && frame.len == MC_EXPECTED_SIZE && compositor_output(compositor) != FRAME_NONE) {
+                recorded = frame_pool_data(pool, compositor_output(compositor));
+            }
+            if (recorded && history_enabled(history)) {
+                history_append(history, recorded, rx_ns);
+            }
+            stats_set_governor(&stats, governor_level_label(governor), governor_coalesced(governor));
+            update_stats_and_log(&stats, (ssize_t)frame.len);
+            stats_record_source(&stats, &frame.src, frame.len);
+
+            merge_release(rx, &frame);
         }
 
-        if (mc_sock >= 0) {
-            fd_set rfds;
-            FD_ZERO(&rfds);
-            FD_SET(mc_sock, &rfds);
-
-            struct timeval tv;
-            tv.tv_sec = 0;
-            tv.tv_usec = 0; // poll, no block
-
-            int ret = select(mc_sock + 1, &rfds, NULL, NULL, &tv);
-            if (ret > 0 && FD_ISSET(mc_sock, &rfds)) {
-                ssize_t n = recv(mc_sock, mc_buf, sizeof(mc_buf), 0);
-                if (n > 0) {
-                    update_stats_and_log(&stats, n);
-
-                    if ((size_t)n == MC_EXPECTED_SIZE) {
-                        draw_pixels_from_buffer(renderer, mc_buf, (size_t)n);
-                    } else {
-                        fprintf(stderr,
-                                "Warning: received unexpected frame size: %zd bytes (expected %d), frame ignored\n",
-                                n,
-                                MC_EXPECTED_SIZE);
-                    }
+        // Overlays on their own groups, and layers timing out, change the
+        // output without a frame on the main stream.
+        if (compositor_active(compositor)) {
+            const uint64_t now = realtime_ns();
+            compositor_poll(compositor, now);
+            const int shown_slot = compositor_compose(compositor);
+            if (shown_slot != FRAME_NONE) {
+                const unsigned char *shown = frame_pool_data(pool, shown_slot);
+                offer_frame(&out, shown, shown_slot, NULL, NULL);
+                if (history_enabled(history)) {
+                    history_append(history, shown, now);
                 }
             }
         }
 
-        SDL_Delay(10);
+        flush_pending(&out);
+        frame_pool_watch_end(pool, stats.total_frames > FRAME_POOL_WARMUP);
+
+        if (governor_update(governor, SDL_GetTicksNS())) {
+            display_set_lean(display, governor_lean(governor));
+            display_set_cheap_path(display, governor_cheap_path(governor));
+        }
+
+        if (!rx->busy_poll) {
+            SDL_Delay(10);
+        }
+    }
+
+    if (merge_active(rx)) {
+        print_receive_summary(&stats, merge_backend_name(rx), merge_syscalls(rx));
+        print_merge_summary(rx);
     }
+    print_compositor_summary(compositor);
+    print_history_summary(history);
+    print_governor_summary(governor, SDL_GetTicksNS());
+    print_frame_pool_summary(pool);
+
+    frame_pool_unref(pool, out.pending.frame);
+    out.pending.frame = FRAME_NONE;
 }
 
 int main(int argc, char **argv) {
-    (void)argc;
-    (void)argv;
+    AppConfig config = DEFAULT_APPCONFIG;
 
-    const AppConfig config = DEFAULT_APPCONFIG;
+    OptionsResult opts = parse_options(argc, argv, &config);
+    if (opts != OPTIONS_OK) {
+        return opts == OPTIONS_EXIT ? 0 : 1;
+    }
 
-    SDL_Window *window = NULL;
-    SDL_Renderer *renderer = NULL;
+    Display display;
 
-    if (!init_sdl(&config, &window, &renderer)) {
+    if (!init_sdl(&config, &display)) {
         return 1;
     }
 
-    int mc_sock = setup_multicast_socket(&config);
-    if (mc_sock < 0) {
-        fprintf(stderr, "Warning: multicast setup failed, continuing without UDP\n");
+    if (display.renderer) {
+        printf("Render path: renderer (%s)\n", SDL_GetRendererName(display.renderer));
+    } else {
+        printf("Render path: surface\n");
+    }
+    if (display.remapped) {
+        printf("Remap: %dx%d to %dx%d, %s, %u taps%s\n",
+               WIDTH,
+               HEIGHT,
+               display.cols,
+               display.rows,
+               remap_filter_name(config.remap_filter),
+               display.remap.tap_count,
+               config.remap_serpentine ? ", serpentine on the frame bus" : "");
+    }
+
+    // Every frame buffer the loop keeps comes from here, allocated once.
+    FramePool pool;
+    if (!frame_pool_init(&pool, config.huge_pages)) {
+        shutdown_sdl(&display);
+        return 1;
     }
 
-    receive_and_render_loop(renderer, mc_sock);
+    int socks[MC_MAX_PATHS];
+    const char *labels[MC_MAX_PATHS];
+    int path_count = 0;
+    char default_label[64];
 
-    if (mc_sock >= 0) {
-        close(mc_sock);
+    if (config.mc_path_count == 0) {
+        socks[0] = setup_multicast_socket(&config);
+        if (socks[0] < 0) {
+            fprintf(stderr, "Warning: multicast setup failed, continuing without UDP\n");
+        }
+        snprintf(default_label, sizeof(default_label), "%s:%d", config.mc_group, config.mc_port);
+        labels[0] = default_label;
+        path_count = 1;
+    } else {
+        // A failed path only loses its redundancy; keep the others.
+        for (int i = 0; i < config.mc_path_count; ++i) {
+            socks[i] = setup_multicast_path(&config, config.mc_paths[i]);
+            if (socks[i] < 0) {
+                fprintf(stderr, "Warning: receive path %s setup failed, continuing without it\n", config.mc_paths[i]);
+            }
+            labels[i] = config.mc_paths[i];
+        }
+        path_count = config.mc_path_count;
     }
 
-    SDL_DestroyRenderer(renderer);
-    SDL_DestroyWindow(window);
-    SDL_Quit();
+    // Static: with a receive buffer per path it is too big for the stack.
+    static MergeReceiver rx;
+    merge_init(&rx, &config, &pool, socks, labels, path_count);
+
+    // Static: every overlay has its own receiver.
+    static Compositor compositor;
+    if (!compositor_init(&compositor, &config, &pool)) {
+        merge_close(&rx);
+        frame_pool_free(&pool);
+        shutdown_sdl(&display);
+        return 1;
+    }
+
+    // Frame bus failures are not fatal: the banner still works on its own.
+    // Static: it carries a remapped frame buffer.
+    static BusOutput bus;
+    if (config.shm_name) {
+        const uint32_t bus_w = display.remapped ? (uint32_t)config.remap_width : WIDTH;
+        const uint32_t bus_h = display.remapped ? (uint32_t)config.remap_height : HEIGHT;
+        const uint32_t order = config.remap_serpentine ? FRAMEBUS_ORDER_SERPENTINE : FRAMEBUS_ORDER_ROW_MAJOR;
+        bus.remapped = display.remapped;
+        if ((bus.remapped && !remap_build(&bus.remap, (int)bus_w, (int)bus_h, config.remap_filter, config.remap_serpentine)) ||
+            !framebus_open_writer(&bus.writer, config.shm_name, bus_w, bus_h, order, (uint32_t)config.shm_history)) {
+            fprintf(stderr, "Warning: frame bus setup failed, continuing without it\n");
+            bus.remapped = false;
+        }
+    }
+
+    // Static: it carries a frame-sized delta base. The arena is allocated
+    // once here; recording never allocates.
+    static History history;
+    history_init(&history, config.history_minutes, config.history_mb);
+
+    Governor governor;
+    governor_init(&governor, config.governor, display_refresh_rate(&display), SDL_GetTicksNS());
+
+    apply_low_latency_settings(&config);
+
+    receive_and_render_loop(&pool, &display, &rx, &compositor, &bus, &history, &governor);
+
+    history_free(&history);
+    framebus_close_writer(&bus.writer);
+    remap_free(&bus.remap);
+    compositor_close(&compositor);
+    merge_close(&rx);
+    frame_pool_free(&pool);
+
+    shutdown_sdl(&display);
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,270 @@
+/*
+
+Copyright 2025 Marc Ketel
+SPDX-License-Identifier: Apache-2.0
+
+*/
+
+#include "merge.h"
+#include "timeutil.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+static_assert(MC_MAX_PATHS <= 32, "path bits must fit in MergeEntry.paths");
+
+// Arrival time of a frame: the kernel receive timestamp when there is
+// one, so the skew between paths does not include our polling order.
+static uint64_t arrival_ns(const ReceivedFrame *frame) {
+    if (frame->have_rx_ts) {
+        return timespec_to_ns(&frame->rx_ts);
+    }
+    return realtime_ns();
+}
+
+// 64-bit multiply-xorshift over 8-byte words; only has to tell frames
+// apart within a merge window, not resist anyone.
+static uint64_t frame_hash(const unsigned char *data, size_t len) {
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ len;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t w;
+        memcpy(&w, data + i, sizeof(w));
+        h = (h ^ w) * 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 32;
+    }
+    for (; i < len; ++i) {
+        h = (h ^ data[i]) * 0x100000001B3ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+void merge_init(MergeReceiver *m, const AppConfig *config, FramePool *pool, const int *socks, const char *const *labels, int count) {
+    memset(m, 0, sizeof(*m));
+    m->path_count = count < MC_MAX_PATHS ? count : MC_MAX_PATHS;
+    m->busy_poll = config->busy_poll;
+    m->window_ns = (uint64_t)config->merge_window_ms * 1000000ULL;
+    m->held_path = -1;
+
+    for (int i = 0; i < m->path_count; ++i) {
+        MergePath *p = &m->paths[i];
+        snprintf(p->label, sizeof(p->label), "%s", labels[i]);
+        p->sock = socks[i];
+        receiver_init(&p->rx, config, pool, socks[i]);
+        if (socks[i] >= 0) {
+            m->live_paths++;
+        }
+    }
+
+    if (m->path_count > 1) {
+        printf("Hitless merge: %d paths, %d ms window\n", m->path_count, config->merge_window_ms);
+    }
+}
+
+bool merge_active(const MergeReceiver *m) {
+    for (int i = 0; i < m->path_count; ++i) {
+        if (m->paths[i].sock >= 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// A frame leaves the window: if only one path ever delivered it, the
+// others lost it and that path rescued it. A path that failed to set up
+// loses nothing, so with one live path there is nothing to rescue.
+static void retire_occurrence(MergeReceiver *m, MergeOccurrence *o) {
+    if (o->paths != 0 && (o->paths & (o->paths - 1)) == 0 && m->live_paths > 1) {
+        m->paths[o->first_path].rescued++;
+    }
+    o->paths = 0;
+}
+
+static void retire_entry(MergeReceiver *m, MergeEntry *e) {
+    for (int i = 0; i < MERGE_OCCURRENCES; ++i) {
+        retire_occurrence(m, &e->occ[i]);
+    }
+    e->used = false;
+}
+
+// True if the frame is new and should be rendered, false for a copy of a
+// frame already delivered by another path.
+static bool merge_accept(MergeReceiver *m, int path, const ReceivedFrame *frame) {
+    const uint64_t now = arrival_ns(frame);
+    const uint64_t hash = frame_hash(frame->data, frame->len);
+    const unsigned bit = 1U << path;
+
+    MergeEntry *match = NULL;
+    for (int i = 0; i < MERGE_WINDOW_ENTRIES; ++i) {
+        MergeEntry *e = &m->window[i];
+        if (!e->used) {
+            continue;
+        }
+        if (now > e->last_ns + m->window_ns) {
+            retire_entry(m, e);
+            continue;
+        }
+        for (int k = 0; k < MERGE_OCCURRENCES; ++k) {
+            if (e->occ[k].paths != 0 && now > e->occ[k].first_ns + m->window_ns) {
+                retire_occurrence(m, &e->occ[k]);
+            }
+        }
+        if (e->hash == hash) {
+            match = e;
+        }
+    }
+
+    if (!match) {
+        match = &m->window[m->window_next];
+        m->window_next = (m->window_next + 1) % MERGE_WINDOW_ENTRIES;
+        if (match->used) {
+            retire_entry(m, match);
+        }
+        memset(match, 0, sizeof(*match));
+        match->used = true;
+        match->hash = hash;
+    }
+    match->last_ns = now;
+
+    // The n-th arrival of this content on this path is a copy of the n-th
+    // occurrence, as long as that is still in the window.
+    uint32_t n = ++match->count[path];
+    if (n <= match->lead) {
+        MergeOccurrence *o = &match->occ[(n - 1) % MERGE_OCCURRENCES];
+        if (match->lead - n < MERGE_OCCURRENCES && o->paths != 0) {
+            o->paths |= bit;
+            m->duplicates++;
+            m->paths[path].duplicates++;
+
+            // Polling order can hand us the later copy first; the kernel
+            // timestamps decide which path really won.
+            if (now >= o->first_ns) {
+                latency_record(&m->paths[path].late_by, (long long)(now - o->first_ns));
+            } else {
+                latency_record(&m->paths[o->first_path].late_by, (long long)(o->first_ns - now));
+                m->paths[o->first_path].first--;
+                m->paths[path].first++;
+                o->first_path = path;
+                o->first_ns = now;
+            }
+            return false;
+        }
+        // Further behind than the window: this path is out of step with
+        // the others, so pick it up again at the lead.
+        n = match->count[path] = match->lead + 1;
+    }
+
+    // An occurrence no path has delivered yet: a new frame.
+    match->lead = n;
+    MergeOccurrence *o = &match->occ[(n - 1) % MERGE_OCCURRENCES];
+    retire_occurrence(m, o);
+    o->first_ns = now;
+    o->paths = bit;
+    o->first_path = path;
+
+    m->paths[path].first++;
+    m->unique_frames++;
+    return true;
+}
+
+bool merge_poll(MergeReceiver *m, ReceivedFrame *out) {
+    if (m->path_count == 1) {
+        if (!receiver_poll(&m->paths[0].rx, out)) {
+            return false;
+        }
+        m->paths[0].received++;
+        m->held_path = 0;
+        return true;
+    }
+
+    for (int n = 0; n < m->path_count; ++n) {
+        int path = (m->next_path + n) % m->path_count;
+        MergePath *p = &m->paths[path];
+
+        // Drain this path until it has nothing new, so a stream of
+        // duplicates never delays the next path.
+        while (receiver_poll(&p->rx, out)) {
+            p->received++;
+            // Odd-sized datagrams are passed on for the caller to reject.
+            if (out->len != MC_EXPECTED_SIZE || merge_accept(m, path, out)) {
+                m->next_path = (path + 1) % m->path_count;
+                m->held_path = path;
+                return true;
+            }
+            receiver_release(&p->rx, out);
+        }
+    }
+    return false;
+}
+
+void merge_release(MergeReceiver *m, ReceivedFrame *frame) {
+    if (m->held_path >= 0) {
+        receiver_release(&m->paths[m->held_path].rx, frame);
+        m->held_path = -1;
+    }
+}
+
+unsigned long merge_syscalls(const MergeReceiver *m) {
+    unsigned long total = 0;
+    for (int i = 0; i < m->path_count; ++i) {
+        total += receiver_syscalls(&m->paths[i].rx);
+    }
+    return total;
+}
+
+// All paths are set up from the same config; report the first live one.
+const char *merge_backend_name(const MergeReceiver *m) {
+    for (int i = 0; i < m->path_count; ++i) {
+        if (m->paths[i].sock >= 0) {
+            return recv_backend_name(m->paths[i].rx.backend);
+        }
+    }
+    return recv_backend_name(RECV_BACKEND_SOCKET);
+}
+
+void print_merge_summary(MergeReceiver *m) {
+    if (m->path_count < 2) {
+        return;
+    }
+
+    for (int i = 0; i < MERGE_WINDOW_ENTRIES; ++i) {
+        if (m->window[i].used) {
+            retire_entry(m, &m->window[i]);
+        }
+    }
+
+    printf("Merge summary: %lu unique frames, %lu duplicates dropped\n", m->unique_frames, m->duplicates);
+    for (int i = 0; i < m->path_count; ++i) {
+        const MergePath *p = &m->paths[i];
+        printf("  path %d (%s)%s: %lu received, %lu duplicates dropped, %lu first, %lu rescued\n",
+               i,
+               p->label,
+               p->sock < 0 ? " [setup failed]" : "",
+               p->received,
+               p->duplicates,
+               p->first,
+               p->rescued);
+        if (p->late_by.total > 0) {
+            printf("    skew behind first copy (us): p50 %.1f, p99 %.1f, max %.1f (%lu frames)\n",
+                   latency_percentile(&p->late_by, 50.0) / 1e3,
+                   latency_percentile(&p->late_by, 99.0) / 1e3,
+                   p->late_by.max_ns / 1e3,
+                   p->late_by.total);
+        }
+    }
+    fflush(stdout);
+}
+
+void merge_close(MergeReceiver *m) {
+    for (int i = 0; i < m->path_count; ++i) {
+        receiver_close(&m->paths[i].rx);
+        if (m->paths[i].sock >= 0) {
+            close(m->paths[i].sock);
+        }
+    }
+}
@@ -0,0 +1,101 @@
+/*
+
+Copyright 2025 Marc Ketel
+SPDX-License-Identifier: Apache-2.0
+
+*/
+
+/*
+ * Hitless merge of redundant receive paths.
+ *
+ * The sender can put the same frame stream on several groups or
+ * interfaces (--path). Every path has its own socket and receiver; frames
+ * are deduplicated across paths and whichever copy arrives first is
+ * rendered, so a frame lost on one path is covered by another, in the
+ * spirit of SMPTE 2022-7.
+ *
+ * Frames carry no sequence number, so copies are matched by a hash of the
+ * frame content within a short window (--merge-window). The same content
+ * can legitimately repeat (a static banner), so every content hash counts
+ * how often each path delivered it: the n-th arrival on a path is a copy
+ * of the n-th occurrence on the leading path, however far behind it is
+ * within the window. Only an arrival beyond the leading path's count is a
+ * new frame.
+ *
+ * With a single path frames pass straight through, without hashing.
+ */
+
+#ifndef MERGE_H
+#define MERGE_H
+
+#include "config.h"
+#include "receiver.h"
+#include "stats.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Recently seen frame contents; comfortably more than a merge window's
+// worth at the frame rates the banner sees.
+#define MERGE_WINDOW_ENTRIES 64
+// Occurrences of one content tracked for copies; a path further behind
+// than this is out of step and resynchronised.
+#define MERGE_OCCURRENCES 8
+
+typedef struct MergePath {
+    char label[96]; // GROUP:PORT[@IFACE], for the summary
+    int sock;
+    Receiver rx;
+
+    unsigned long received;   // datagrams, including duplicates
+    unsigned long duplicates; // copies dropped here, never passed on (so not in the per-sender stats)
+    unsigned long first;      // frames this path delivered first
+    unsigned long rescued;    // frames only this path delivered
+    LatencyHistogram late_by; // arrival after the first copy, for duplicates
+} MergePath;
+
+// One delivery of a content hash, with its copies on the other paths.
+typedef struct MergeOccurrence {
+    uint64_t first_ns; // arrival of the first copy, CLOCK_REALTIME ns
+    unsigned paths;    // bit per path that delivered a copy, 0 = retired
+    int first_path;
+} MergeOccurrence;
+
+typedef struct MergeEntry {
+    bool used;
+    uint64_t hash;
+    uint64_t last_ns;                         // latest arrival on any path
+    uint32_t lead;                            // occurrences so far, the leading path's count
+    uint32_t count[MC_MAX_PATHS];             // arrivals per path
+    MergeOccurrence occ[MERGE_OCCURRENCES];   // occurrence n (1-based) at (n - 1) % MERGE_OCCURRENCES
+} MergeEntry;
+
+typedef struct MergeReceiver {
+    MergePath paths[MC_MAX_PATHS];
+    int path_count;
+    bool busy_poll;
+    uint64_t window_ns;
+    int next_path; // round-robin poll start
+    int held_path; // path of the frame handed out by merge_poll(), -1 = none
+    int live_paths; // paths with a socket; a rescue needs another one
+
+    MergeEntry window[MERGE_WINDOW_ENTRIES];
+    int window_next; // oldest entry, overwritten next
+    unsigned long unique_frames;
+    unsigned long duplicates;
+} MergeReceiver;
+
+// Takes ownership of the sockets (closed by merge_close()). Sockets < 0
+// are paths that failed to set up; they are kept for the summary.
+void merge_init(MergeReceiver *m, const AppConfig *config, FramePool *pool, const int *socks, const char *const *labels, int count);
+bool merge_active(const MergeReceiver *m); // at least one path has a socket
+// Non-blocking; true if a frame to render was received. Duplicates are
+// released internally. The frame must be released with merge_release().
+bool merge_poll(MergeReceiver *m, ReceivedFrame *out);
+void merge_release(MergeReceiver *m, ReceivedFrame *frame);
+unsigned long merge_syscalls(const MergeReceiver *m);
+const char *merge_backend_name(const MergeReceiver *m);
+void print_merge_summary(MergeReceiver *m);
+void merge_close(MergeReceiver *m);
+
+#endif // MERGE_H
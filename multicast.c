@@ -8,11 +8,105 @@ SPDX-License-Identifier: Apache-2.0
 #include "multicast.h"
 
 #include <arpa/inet.h>
+#include <net/if.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
+void configure_busy_poll(int sock, int usec) {
+    // SO_BUSY_POLL makes reads poll the device queue for up to usec before
+    // giving up; raising it above net.core.busy_read needs CAP_NET_ADMIN.
+    // Without it the receive loop still spins on non-blocking reads.
+#ifdef SO_BUSY_POLL
+    if (setsockopt(sock, SOL_SOCKET, SO_BUSY_POLL, &usec, sizeof(usec)) < 0) {
+        perror("setsockopt(SO_BUSY_POLL)");
+    } else {
+        printf("SO_BUSY_POLL set to %d us\n", usec);
+    }
+#else
+    (void)usec;
+    printf("SO_BUSY_POLL not available, spinning on non-blocking reads only\n");
+#endif
+
+#ifdef SO_PREFER_BUSY_POLL
+    int prefer = 1;
+    if (setsockopt(sock, SOL_SOCKET, SO_PREFER_BUSY_POLL, &prefer, sizeof(prefer)) < 0) {
+        perror("setsockopt(SO_PREFER_BUSY_POLL)");
+    }
+#endif
+}
+
+// Accepts an interface name ("wlan0") or index ("3").
+static bool resolve_interface(const char *iface, unsigned *out_index) {
+    char *end = NULL;
+    unsigned long idx = strtoul(iface, &end, 10);
+    if (end && end != iface && *end == '\0') {
+        char name[IF_NAMESIZE];
+        if (idx == 0 || idx > 0xFFFFFFFFUL || !if_indextoname((unsigned)idx, name)) {
+            fprintf(stderr, "No network interface with index %s\n", iface);
+            return false;
+        }
+        *out_index = (unsigned)idx;
+        return true;
+    }
+
+    unsigned found = if_nametoindex(iface);
+    if (found == 0) {
+        fprintf(stderr, "No network interface named %s\n", iface);
+        return false;
+    }
+    *out_index = found;
+    return true;
+}
+
+// Any-source join: every sender to the group is delivered.
+static bool join_any_source(int sock, struct in_addr group, unsigned ifindex) {
+    struct ip_mreqn mreq;
+    memset(&mreq, 0, sizeof(mreq));
+    mreq.imr_multiaddr = group;
+    mreq.imr_address.s_addr = htonl(INADDR_ANY);
+    mreq.imr_ifindex = (int)ifindex;
+
+    if (setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+        perror("setsockopt(IP_ADD_MEMBERSHIP)");
+        return false;
+    }
+    return true;
+}
+
+// Source-specific join: the kernel drops datagrams from any other sender
+// (and with IGMPv3 snooping, so does the network). MCAST_JOIN_SOURCE_GROUP
+// is used rather than IP_ADD_SOURCE_MEMBERSHIP because it takes an
+// interface index instead of an interface address.
+static bool join_source(int sock, struct in_addr group, const char *source, unsigned ifindex) {
+    struct in_addr src_addr;
+    if (inet_aton(source, &src_addr) == 0) {
+        fprintf(stderr, "Invalid source address: %s\n", source);
+        return false;
+    }
+
+    struct group_source_req req;
+    memset(&req, 0, sizeof(req));
+    req.gsr_interface = ifindex;
+
+    struct sockaddr_in *grp = (struct sockaddr_in *)&req.gsr_group;
+    grp->sin_family = AF_INET;
+    grp->sin_addr = group;
+
+    struct sockaddr_in *src = (struct sockaddr_in *)&req.gsr_source;
+    src->sin_family = AF_INET;
+    src->sin_addr = src_addr;
+
+    if (setsockopt(sock, IPPROTO_IP, MCAST_JOIN_SOURCE_GROUP, &req, sizeof(req)) < 0) {
+        perror("setsockopt(MCAST_JOIN_SOURCE_GROUP)");
+        return false;
+    }
+    printf("Accepting frames from source %s\n", source);
+    return true;
+}
+
 int setup_multicast_socket(const AppConfig *config) {
     if (!config) {
         fprintf(stderr, "Invalid configuration: config is NULL\n");
@@ -42,19 +136,6 @@ int setup_multicast_socket(const AppConfig *config) {
         return -1;
     }
 
-    struct sockaddr_in addr;
-    memset(&addr, 0, sizeof(addr));
-    addr.sin_family = AF_INET;
-    addr.sin_port = htons(config->mc_port);
-    addr.sin_addr.s_addr = htonl(INADDR_ANY);
-
-    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
-        perror("bind");
-        close(sock);
-        return -1;
-    }
-    printf("Bound to INADDR_ANY:%d, waiting for multicast group join...\n", config->mc_port);
-
     struct in_addr mc_addr;
     if (inet_aton(config->mc_group, &mc_addr) == 0) {
         fprintf(stderr, "Invalid multicast group address: %s\n", config->mc_group);
@@ -72,20 +153,97 @@ int setup_multicast_socket(const AppConfig *config) {
         return -1;
     }
 
-    struct ip_mreqn mreq;
-    memset(&mreq, 0, sizeof(mreq));
-    mreq.imr_multiaddr = mc_addr;
-    mreq.imr_address.s_addr = htonl(INADDR_ANY);
-    mreq.imr_ifindex = 0;
+    unsigned ifindex = 0;
+    if (config->mc_iface) {
+        if (!resolve_interface(config->mc_iface, &ifindex)) {
+            close(sock);
+            return -1;
+        }
+        printf("Joining on interface %s (index %u)\n", config->mc_iface, ifindex);
+    }
 
-    if (setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
-        perror("setsockopt(IP_ADD_MEMBERSHIP)");
+    // Binding to the group address instead of INADDR_ANY keeps unicast
+    // and other groups' traffic to the same port out of this socket.
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(config->mc_port);
+    addr.sin_addr = mc_addr;
+
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("bind");
         close(sock);
         return -1;
     }
+    printf("Bound to %s:%d, waiting for multicast group join...\n", config->mc_group, config->mc_port);
+
+#ifdef IP_MULTICAST_ALL
+    // Linux otherwise delivers traffic for groups (and sources) joined by
+    // any socket on the host, bypassing this socket's source filter.
+    int all = 0;
+    if (setsockopt(sock, IPPROTO_IP, IP_MULTICAST_ALL, &all, sizeof(all)) < 0) {
+        perror("setsockopt(IP_MULTICAST_ALL)");
+    }
+#endif
+
+    bool joined = true;
+    if (config->mc_source_count == 0) {
+        joined = join_any_source(sock, mc_addr, ifindex);
+    } else {
+        for (int i = 0; i < config->mc_source_count && joined; ++i) {
+            joined = join_source(sock, mc_addr, config->mc_sources[i], ifindex);
+        }
+    }
+    if (!joined) {
+        close(sock);
+        return -1;
+    }
+
+    // Kernel receive timestamps, used to measure receive and display latency.
+    int on = 1;
+    if (setsockopt(sock, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) < 0) {
+        perror("setsockopt(SO_TIMESTAMPNS)");
+    }
+
+    if (config->busy_poll) {
+        configure_busy_poll(sock, config->busy_poll_usec);
+    }
 
     printf("Subscribed to multicast group %s on port %d. Ready to receive data.\n",
            config->mc_group, config->mc_port);
 
     return sock;
+}
+
+int setup_multicast_path(const AppConfig *config, const char *spec) {
+    char buf[96];
+    if (strlen(spec) >= sizeof(buf)) {
+        fprintf(stderr, "Invalid path: %s (too long)\n", spec);
+        return -1;
+    }
+    snprintf(buf, sizeof(buf), "%s", spec);
+
+    AppConfig path = *config;
+
+    char *iface = strchr(buf, '@');
+    if (iface) {
+        *iface++ = '\0';
+        path.mc_iface = iface;
+    }
+
+    char *port = strchr(buf, ':');
+    if (port) {
+        *port++ = '\0';
+        char *end = NULL;
+        long v = strtol(port, &end, 10);
+        if (!end || end == port || *end != '\0' || v <= 0 || v > 65535) {
+            fprintf(stderr, "Invalid port in path %s\n", spec);
+            return -1;
+        }
+        path.mc_port = (int)v;
+    }
+    path.mc_group = buf;
+
+    printf("Setting up receive path %s\n", spec);
+    return setup_multicast_socket(&path);
 }
\ No newline at end of file
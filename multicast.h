@@ -11,5 +11,8 @@ SPDX-License-Identifier: Apache-2.0
 #include "config.h"
 
 int setup_multicast_socket(const AppConfig *config);
+// Same, for one GROUP[:PORT][@IFACE] path; unset parts come from config.
+int setup_multicast_path(const AppConfig *config, const char *spec);
+void configure_busy_poll(int sock, int usec);
 
 #endif // MULTICAST_H
\ No newline at end of file
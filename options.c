@@ -0,0 +1,344 @@
+/*
+
+Copyright 2025 Marc Ketel
+SPDX-License-Identifier: Apache-2.0
+
+*/
+
+#include "options.h"
+#include "framebus.h"
+
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Long-only options use values outside the printable character range.
+enum {
+    OPT_RENDER_DRIVER = 0x100,
+    OPT_RECV,
+    OPT_BUSY_POLL,
+    OPT_CPU,
+    OPT_SCHED_FIFO,
+    OPT_MLOCK,
+    OPT_HUGEPAGES,
+    OPT_SHM,
+    OPT_SHM_HISTORY,
+    OPT_SOURCE,
+    OPT_IFACE,
+    OPT_PATH,
+    OPT_MERGE_WINDOW,
+    OPT_COLOR_PROFILE,
+    OPT_HISTORY,
+    OPT_HISTORY_MEM,
+    OPT_LAYER,
+    OPT_REMAP,
+    OPT_NO_GOVERNOR,
+};
+
+static void print_usage(FILE *out, const char *prog) {
+    fprintf(out,
+            "Usage: %s [options]\n"
+            "\n"
+            "Options:\n"
+            "      --source ADDR         only accept frames from sender ADDR (source-specific join,\n"
+            "                            repeat for up to %d senders; default: any source)\n"
+            "      --iface NAME|INDEX    join the multicast group on this interface (default: kernel's choice)\n"
+            "      --path GROUP[:PORT][@IFACE]\n"
+            "                            receive path for the hitless merge; repeat for up to %d redundant\n"
+            "                            paths, the first copy of each frame is rendered\n"
+            "      --merge-window MS     how long copies of a frame are matched across paths (default: %d)\n"
+            "      --layer FROM[,key=RGB565][,alpha=N][,timeout=MS]\n"
+            "                            composite the latest frame from FROM over the main stream; FROM is\n"
+            "                            a sender address or GROUP[:PORT][@IFACE]; repeat for up to %d\n"
+            "                            layers, later ones on top (default timeout: %d ms, 0 = never)\n"
+            "      --recv BACKEND        receive backend: socket or uring (default: socket)\n"
+            "                            uring falls back to socket on kernels without support\n"
+            "      --busy-poll[=USEC]    low-latency mode: spin on the socket instead of select() +\n"
+            "                            10 ms sleeps, with SO_BUSY_POLL=USEC where allowed (default: %d)\n"
+            "      --cpu N               pin the receive loop to CPU N (ideally an isolated core)\n"
+            "      --sched-fifo[=PRIO]   run the receive loop as SCHED_FIFO (default priority: %d)\n"
+            "      --mlock               lock all current and future memory with mlockall()\n"
+            "      --hugepages           put the frame pool on huge pages (needs vm.nr_hugepages > 0)\n"
+            "      --shm[=NAME]          publish frames to the shared-memory frame bus /dev/shm/NAME\n"
+            "                            (default: %s)\n"
+            "      --shm-history N       frames of history kept on the frame bus (default: 1)\n"
+            "      --history MIN         keep the last MIN minutes of frames for rewinding, 0 = off\n"
+            "                            (default: %d)\n"
+            "      --history-mem MB      memory allocated at startup for --history (default: %d)\n"
+            "      --remap WxH[,nearest|box][,serpentine]\n"
+            "                            drive a WxH matrix (up to %dx%d) from the 80x8 stream, on screen\n"
+            "                            and on the frame bus; box averages when scaling down (default:\n"
+            "                            nearest); serpentine reverses every other row on the frame bus\n"
+            "      --no-governor         keep rendering every frame under overload instead of coalescing\n"
+            "                            frames and shedding render work until the loop keeps up\n"
+            "  -r, --render PATH         render path: auto, renderer or surface (default: auto)\n"
+            "                            auto uses the surface path when SDL only has its software renderer\n"
+            "      --render-driver NAME  SDL render driver for the renderer path (default: SDL's choice)\n"
+            "      --color-profile P     colour calibration: linear, ledbanner-uncalibrated (a placeholder,\n"
+            "                            not measured) or a profile file; repeat to\n"
+            "                            add profiles to cycle through with C (default: linear)\n"
+            "  -s, --size WxH            initial window size (default: 8x the LED matrix)\n"
+            "  -h, --help                show this help and exit\n",
+            prog,
+            MC_MAX_SOURCES,
+            MC_MAX_PATHS,
+            MERGE_WINDOW_DEFAULT_MS,
+            LAYER_MAX_OVERLAYS,
+            LAYER_DEFAULT_TIMEOUT_MS,
+            BUSY_POLL_DEFAULT_USEC,
+            SCHED_FIFO_DEFAULT_PRIO,
+            FRAMEBUS_DEFAULT_NAME,
+            HISTORY_DEFAULT_MINUTES,
+            HISTORY_DEFAULT_MB,
+            REMAP_MAX_WIDTH,
+            REMAP_MAX_HEIGHT);
+}
+
+static bool parse_render_path(const char *arg, RenderPath *out) {
+    if (strcmp(arg, "auto") == 0) {
+        *out = RENDER_PATH_AUTO;
+    } else if (strcmp(arg, "renderer") == 0) {
+        *out = RENDER_PATH_RENDERER;
+    } else if (strcmp(arg, "surface") == 0) {
+        *out = RENDER_PATH_SURFACE;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool parse_int(const char *arg, int min, int max, int *out) {
+    char *end = NULL;
+    long v = strtol(arg, &end, 10);
+    if (!end || end == arg || *end != '\0' || v < min || v > max) {
+        return false;
+    }
+    *out = (int)v;
+    return true;
+}
+
+bool parse_remap(const char *arg, AppConfig *config) {
+    char buf[64];
+    if (strlen(arg) >= sizeof(buf)) {
+        return false;
+    }
+    snprintf(buf, sizeof(buf), "%s", arg);
+
+    char *opts = strchr(buf, ',');
+    if (opts) {
+        *opts++ = '\0';
+    }
+    int w = 0;
+    int h = 0;
+    char tail = 0;
+    if (sscanf(buf, "%dx%d%c", &w, &h, &tail) != 2 || w <= 0 || h <= 0 || w > REMAP_MAX_WIDTH ||
+        h > REMAP_MAX_HEIGHT) {
+        return false;
+    }
+
+    RemapFilter filter = REMAP_FILTER_NEAREST;
+    bool serpentine = false;
+    for (char *opt = opts ? strtok(opts, ",") : NULL; opt; opt = strtok(NULL, ",")) {
+        if (strcmp(opt, "nearest") == 0) {
+            filter = REMAP_FILTER_NEAREST;
+        } else if (strcmp(opt, "box") == 0) {
+            filter = REMAP_FILTER_BOX;
+        } else if (strcmp(opt, "serpentine") == 0) {
+            serpentine = true;
+        } else {
+            return false;
+        }
+    }
+
+    config->remap_width = w;
+    config->remap_height = h;
+    config->remap_filter = filter;
+    config->remap_serpentine = serpentine;
+    return true;
+}
+
+static bool parse_size(const char *arg, int *out_w, int *out_h) {
+    int w = 0;
+    int h = 0;
+    char tail = 0;
+    if (sscanf(arg, "%dx%d%c", &w, &h, &tail) != 2 || w <= 0 || h <= 0) {
+        return false;
+    }
+    *out_w = w;
+    *out_h = h;
+    return true;
+}
+
+OptionsResult parse_options(int argc, char **argv, AppConfig *config) {
+    static const struct option long_options[] = {
+        {"source", required_argument, NULL, OPT_SOURCE},
+        {"iface", required_argument, NULL, OPT_IFACE},
+        {"path", required_argument, NULL, OPT_PATH},
+        {"layer", required_argument, NULL, OPT_LAYER},
+        {"merge-window", required_argument, NULL, OPT_MERGE_WINDOW},
+        {"recv", required_argument, NULL, OPT_RECV},
+        {"busy-poll", optional_argument, NULL, OPT_BUSY_POLL},
+        {"cpu", required_argument, NULL, OPT_CPU},
+        {"sched-fifo", optional_argument, NULL, OPT_SCHED_FIFO},
+        {"mlock", no_argument, NULL, OPT_MLOCK},
+        {"hugepages", no_argument, NULL, OPT_HUGEPAGES},
+        {"shm", optional_argument, NULL, OPT_SHM},
+        {"shm-history", required_argument, NULL, OPT_SHM_HISTORY},
+        {"history", required_argument, NULL, OPT_HISTORY},
+        {"history-mem", required_argument, NULL, OPT_HISTORY_MEM},
+        {"remap", required_argument, NULL, OPT_REMAP},
+        {"no-governor", no_argument, NULL, OPT_NO_GOVERNOR},
+        {"render", required_argument, NULL, 'r'},
+        {"render-driver", required_argument, NULL, OPT_RENDER_DRIVER},
+        {"color-profile", required_argument, NULL, OPT_COLOR_PROFILE},
+        {"size", required_argument, NULL, 's'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+
+    const char *prog = (argc > 0 && argv[0]) ? argv[0] : "led80x8";
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "r:s:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'r':
+                if (!parse_render_path(optarg, &config->render_path)) {
+                    fprintf(stderr, "Invalid render path: %s (expected auto, renderer or surface)\n", optarg);
+                    return OPTIONS_ERROR;
+                }
+                break;
+            case OPT_SOURCE:
+                if (config->mc_source_count >= MC_MAX_SOURCES) {
+                    fprintf(stderr, "Too many sources (at most %d)\n", MC_MAX_SOURCES);
+                    return OPTIONS_ERROR;
+                }
+                config->mc_sources[config->mc_source_count++] = optarg;
+                break;
+            case OPT_IFACE:
+                config->mc_iface = optarg;
+                break;
+            case OPT_PATH:
+                if (config->mc_path_count >= MC_MAX_PATHS) {
+                    fprintf(stderr, "Too many paths (at most %d)\n", MC_MAX_PATHS);
+                    return OPTIONS_ERROR;
+                }
+                config->mc_paths[config->mc_path_count++] = optarg;
+                break;
+            case OPT_LAYER:
+                if (config->layer_count >= LAYER_MAX_OVERLAYS) {
+                    fprintf(stderr, "Too many layers (at most %d)\n", LAYER_MAX_OVERLAYS);
+                    return OPTIONS_ERROR;
+                }
+                config->layers[config->layer_count++] = optarg;
+                break;
+            case OPT_MERGE_WINDOW:
+                if (!parse_int(optarg, 1, 10000, &config->merge_window_ms)) {
+                    fprintf(stderr, "Invalid merge window: %s (expected 1-10000 ms)\n", optarg);
+                    return OPTIONS_ERROR;
+                }
+                break;
+            case OPT_RECV:
+                if (strcmp(optarg, "socket") == 0) {
+                    config->recv_backend = RECV_BACKEND_SOCKET;
+                } else if (strcmp(optarg, "uring") == 0) {
+                    config->recv_backend = RECV_BACKEND_URING;
+                } else {
+                    fprintf(stderr, "Invalid receive backend: %s (expected socket or uring)\n", optarg);
+                    return OPTIONS_ERROR;
+                }
+                break;
+            case OPT_BUSY_POLL:
+                config->busy_poll = true;
+                if (optarg && !parse_int(optarg, 0, 1000000, &config->busy_poll_usec)) {
+                    fprintf(stderr, "Invalid busy poll budget: %s (expected 0-1000000 us)\n", optarg);
+                    return OPTIONS_ERROR;
+                }
+                break;
+            case OPT_CPU:
+                if (!parse_int(optarg, 0, 4095, &config->cpu)) {
+                    fprintf(stderr, "Invalid CPU: %s\n", optarg);
+                    return OPTIONS_ERROR;
+                }
+                break;
+            case OPT_SCHED_FIFO:
+                config->rt_priority = SCHED_FIFO_DEFAULT_PRIO;
+                if (optarg && !parse_int(optarg, 1, 99, &config->rt_priority)) {
+                    fprintf(stderr, "Invalid SCHED_FIFO priority: %s (expected 1-99)\n", optarg);
+                    return OPTIONS_ERROR;
+                }
+                break;
+            case OPT_MLOCK:
+                config->lock_memory = true;
+                break;
+            case OPT_HUGEPAGES:
+                config->huge_pages = true;
+                break;
+            case OPT_SHM:
+                config->shm_name = optarg ? optarg : FRAMEBUS_DEFAULT_NAME;
+                break;
+            case OPT_SHM_HISTORY:
+                if (!parse_int(optarg, 1, FRAMEBUS_MAX_HISTORY, &config->shm_history)) {
+                    fprintf(stderr, "Invalid frame bus history: %s (expected 1-1024)\n", optarg);
+                    return OPTIONS_ERROR;
+                }
+                break;
+            case OPT_HISTORY:
+                if (!parse_int(optarg, 0, 24 * 60, &config->history_minutes)) {
+                    fprintf(stderr, "Invalid history length: %s (expected 0-1440 minutes)\n", optarg);
+                    return OPTIONS_ERROR;
+                }
+                break;
+            case OPT_HISTORY_MEM:
+                if (!parse_int(optarg, 1, 4095, &config->history_mb)) {
+                    fprintf(stderr, "Invalid history memory: %s (expected 1-4095 MB)\n", optarg);
+                    return OPTIONS_ERROR;
+                }
+                break;
+            case OPT_REMAP:
+                if (!parse_remap(optarg, config)) {
+                    fprintf(stderr,
+                            "Invalid remap: %s (expected WxH[,nearest|box][,serpentine], up to %dx%d)\n",
+                            optarg,
+                            REMAP_MAX_WIDTH,
+                            REMAP_MAX_HEIGHT);
+                    return OPTIONS_ERROR;
+                }
+                break;
+            case OPT_NO_GOVERNOR:
+                config->governor = false;
+                break;
+            case OPT_RENDER_DRIVER:
+                config->render_driver = optarg;
+                break;
+            case OPT_COLOR_PROFILE:
+                if (config->color_profile_count >= COLOR_MAX_PROFILES) {
+                    fprintf(stderr, "Too many colour profiles (at most %d)\n", COLOR_MAX_PROFILES);
+                    return OPTIONS_ERROR;
+                }
+                config->color_profiles[config->color_profile_count++] = optarg;
+                break;
+            case 's':
+                if (!parse_size(optarg, &config->window_width, &config->window_height)) {
+                    fprintf(stderr, "Invalid window size: %s (expected WxH, e.g. 640x64)\n", optarg);
+                    return OPTIONS_ERROR;
+                }
+                break;
+            case 'h':
+                print_usage(stdout, prog);
+                return OPTIONS_EXIT;
+            default:
+                print_usage(stderr, prog);
+                return OPTIONS_ERROR;
+        }
+    }
+
+    if (optind < argc) {
+        fprintf(stderr, "Unexpected argument: %s\n", argv[optind]);
+        print_usage(stderr, prog);
+        return OPTIONS_ERROR;
+    }
+
+    return OPTIONS_OK;
+}
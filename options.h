@@ -0,0 +1,25 @@
+/*
+
+Copyright 2025 Marc Ketel
+SPDX-License-Identifier: Apache-2.0
+
+*/
+
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include "config.h"
+
+typedef enum OptionsResult {
+    OPTIONS_OK,    // continue with the parsed configuration
+    OPTIONS_EXIT,  // nothing to run (e.g. --help was printed)
+    OPTIONS_ERROR, // invalid command line, usage was printed
+} OptionsResult;
+
+OptionsResult parse_options(int argc, char **argv, AppConfig *config);
+// WxH[,nearest|box][,serpentine] into the config's remap_* fields.
+bool parse_remap(const char *arg, AppConfig *config);
+// The whole of arg as a decimal integer in [min, max].
+bool parse_int(const char *arg, int min, int max, int *out);
+
+#endif // OPTIONS_H
@@ -0,0 +1,198 @@
+/*
+
+Copyright 2025 Marc Ketel
+SPDX-License-Identifier: Apache-2.0
+
+*/
+
+#include "receiver.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/types.h>
+
+// Room for the SO_TIMESTAMPNS receive timestamp.
+#define RX_CONTROL_LEN CMSG_SPACE(sizeof(struct timespec))
+
+static_assert(FRAME_SLOT_SIZE == MC_BUF_SIZE, "pool slots and the fallback buffer hold the same datagrams");
+
+const char *recv_backend_name(RecvBackend backend) {
+    switch (backend) {
+        case RECV_BACKEND_SOCKET:
+            return "socket";
+        case RECV_BACKEND_URING:
+            return "io_uring";
+    }
+    return "unknown";
+}
+
+bool receiver_init(Receiver *rx, const AppConfig *config, FramePool *pool, int sock) {
+    memset(rx, 0, sizeof(*rx));
+    rx->sock = sock;
+    rx->pool = pool;
+    rx->spare = FRAME_NONE;
+    rx->uring.ring_fd = -1;
+    rx->backend = RECV_BACKEND_SOCKET;
+
+    if (sock < 0) {
+        return false;
+    }
+
+    rx->busy_poll = config->busy_poll;
+
+    if (config->recv_backend == RECV_BACKEND_URING) {
+        if (uring_receiver_init(&rx->uring, sock, RX_CONTROL_LEN)) {
+            rx->backend = RECV_BACKEND_URING;
+        } else {
+            fprintf(stderr, "Warning: io_uring receive backend unavailable, using socket backend\n");
+        }
+    }
+
+    printf("Receive backend: %s\n", recv_backend_name(rx->backend));
+    return true;
+}
+
+static void parse_datagram_meta(ReceivedFrame *out, const void *name, size_t name_len, void *control, size_t control_len) {
+    memset(&out->src, 0, sizeof(out->src));
+    if (name_len >= sizeof(out->src)) {
+        memcpy(&out->src, name, sizeof(out->src));
+    }
+
+    out->have_rx_ts = false;
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_control = control;
+    msg.msg_controllen = control_len;
+
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS &&
+            cmsg->cmsg_len >= CMSG_LEN(sizeof(struct timespec))) {
+            memcpy(&out->rx_ts, CMSG_DATA(cmsg), sizeof(out->rx_ts));
+            out->have_rx_ts = true;
+        }
+    }
+}
+
+static bool socket_poll(Receiver *rx, ReceivedFrame *out) {
+    if (!rx->busy_poll) {
+        fd_set rfds;
+        FD_ZERO(&rfds);
+        FD_SET(rx->sock, &rfds);
+
+        struct timeval tv;
+        tv.tv_sec = 0;
+        tv.tv_usec = 0; // poll, no block
+
+        rx->syscalls++;
+        int ret = select(rx->sock + 1, &rfds, NULL, NULL, &tv);
+        if (ret <= 0 || !FD_ISSET(rx->sock, &rfds)) {
+            return false;
+        }
+    }
+
+    struct sockaddr_in src;
+    union {
+        struct cmsghdr align;
+        unsigned char buf[RX_CONTROL_LEN];
+    } control;
+
+    // Straight into a pool slot, so whoever keeps the frame takes a
+    // reference instead of a copy. A slot that saw no datagram is kept for
+    // the next call.
+    if (rx->spare == FRAME_NONE && rx->pool) {
+        rx->spare = frame_pool_acquire(rx->pool);
+    }
+    unsigned char *buf = rx->spare != FRAME_NONE ? frame_pool_data(rx->pool, rx->spare) : rx->buf;
+
+    struct iovec iov;
+    iov.iov_base = buf;
+    iov.iov_len = sizeof(rx->buf);
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = &src;
+    msg.msg_namelen = sizeof(src);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    // Busy-poll mode spins on this call; with SO_BUSY_POLL set the kernel
+    // also polls the device queue before reporting EAGAIN.
+    rx->syscalls++;
+    ssize_t n = recvmsg(rx->sock, &msg, MSG_DONTWAIT);
+    if (n <= 0) {
+        return false;
+    }
+
+    parse_datagram_meta(out, &src, msg.msg_namelen, control.buf, msg.msg_controllen);
+    out->data = buf;
+    out->len = (size_t)n;
+    out->slot = -1;
+    out->pool_slot = rx->spare;
+    rx->spare = FRAME_NONE;
+    return true;
+}
+
+bool receiver_poll(Receiver *rx, ReceivedFrame *out) {
+    if (rx->sock < 0) {
+        return false;
+    }
+
+    if (rx->backend == RECV_BACKEND_URING) {
+        UringCompletion c;
+        UringPollResult res = uring_receiver_poll(&rx->uring, &c);
+        if (res == URING_POLL_FRAME) {
+            parse_datagram_meta(out, c.name, c.name_len, c.control, c.control_len);
+            out->data = c.payload;
+            out->len = c.payload_len;
+            out->slot = c.slot;
+            out->pool_slot = FRAME_NONE;
+            return true;
+        }
+        if (res == URING_POLL_EMPTY) {
+            return false;
+        }
+
+        fprintf(stderr, "Warning: io_uring receive backend failed, falling back to socket backend\n");
+        rx->syscalls += rx->uring.syscalls;
+        uring_receiver_close(&rx->uring);
+        rx->backend = RECV_BACKEND_SOCKET;
+    }
+
+    return socket_poll(rx, out);
+}
+
+void receiver_release(Receiver *rx, ReceivedFrame *frame) {
+    if (rx->backend == RECV_BACKEND_URING && frame->slot >= 0) {
+        uring_receiver_release(&rx->uring, frame->slot);
+    }
+    if (rx->pool) {
+        frame_pool_unref(rx->pool, frame->pool_slot);
+    }
+    frame->data = NULL;
+    frame->slot = -1;
+    frame->pool_slot = FRAME_NONE;
+}
+
+unsigned long receiver_syscalls(const Receiver *rx) {
+    if (rx->backend == RECV_BACKEND_URING) {
+        return rx->syscalls + rx->uring.syscalls;
+    }
+    return rx->syscalls;
+}
+
+void receiver_close(Receiver *rx) {
+    if (rx->backend == RECV_BACKEND_URING) {
+        uring_receiver_close(&rx->uring);
+    }
+    if (rx->pool) {
+        frame_pool_unref(rx->pool, rx->spare);
+        rx->spare = FRAME_NONE;
+    }
+}
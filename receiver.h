@@ -0,0 +1,49 @@
+/*
+
+Copyright 2025 Marc Ketel
+SPDX-License-Identifier: Apache-2.0
+
+*/
+
+#ifndef RECEIVER_H
+#define RECEIVER_H
+
+#include "config.h"
+#include "framepool.h"
+#include "uring.h"
+
+#include <netinet/in.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+
+// One received datagram. data stays valid until receiver_release().
+typedef struct ReceivedFrame {
+    const unsigned char *data;
+    size_t len; // datagram length; only frames of MC_EXPECTED_SIZE are consumed
+    struct sockaddr_in src;
+    struct timespec rx_ts; // kernel receive time (CLOCK_REALTIME), if have_rx_ts
+    bool have_rx_ts;
+    int slot;      // io_uring buffer slot, -1 on the socket backend
+    int pool_slot; // frame pool slot holding data, FRAME_NONE if data is elsewhere
+} ReceivedFrame;
+
+typedef struct Receiver {
+    RecvBackend backend; // backend in use, may differ from the configured one after a fallback
+    int sock;
+    bool busy_poll;                 // spin on non-blocking reads instead of select()
+    FramePool *pool;                // socket backend receives into its slots
+    int spare;                      // slot for the next datagram, FRAME_NONE = none yet
+    unsigned char buf[MC_BUF_SIZE]; // socket backend receive buffer if the pool runs out
+    UringReceiver uring;
+    unsigned long syscalls; // receive path syscalls, for the exit summary
+} Receiver;
+
+bool receiver_init(Receiver *rx, const AppConfig *config, FramePool *pool, int sock);
+bool receiver_poll(Receiver *rx, ReceivedFrame *out); // non-blocking, true if a datagram was received
+void receiver_release(Receiver *rx, ReceivedFrame *frame);
+unsigned long receiver_syscalls(const Receiver *rx);
+void receiver_close(Receiver *rx);
+const char *recv_backend_name(RecvBackend backend);
+
+#endif // RECEIVER_H
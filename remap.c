@@ -0,0 +1,170 @@
+/*
+
+Copyright 2025 Marc Ketel
+SPDX-License-Identifier: Apache-2.0
+
+*/
+
+#include "remap.h"
+#include "rgb565.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WEIGHT_ONE (1u << REMAP_WEIGHT_BITS)
+
+// Source pixels one output column (or row) takes from, with how much of
+// each it covers. Positions are measured in units of 1/dst of a source
+// pixel, so every overlap is an integer and an output pixel covers src
+// units in total.
+typedef struct AxisTaps {
+    int first;
+    int count;
+    int overlap[WIDTH > HEIGHT ? WIDTH : HEIGHT];
+} AxisTaps;
+
+static void axis_taps(AxisTaps *out, int i, int src, int dst, RemapFilter filter) {
+    if (filter == REMAP_FILTER_NEAREST) {
+        // Sample at the centre of the output pixel.
+        out->first = (int)(((long)(2 * i + 1) * src) / (2L * dst));
+        out->count = 1;
+        out->overlap[0] = src;
+        return;
+    }
+
+    const long begin = (long)i * src;
+    const long end = begin + src;
+    out->first = (int)(begin / dst);
+    out->count = 0;
+    for (int s = out->first; s < src && (long)s * dst < end; ++s) {
+        const long lo = (long)s * dst > begin ? (long)s * dst : begin;
+        const long hi = (long)(s + 1) * dst < end ? (long)(s + 1) * dst : end;
+        out->overlap[out->count++] = (int)(hi - lo);
+    }
+}
+
+bool remap_build(RemapTable *t, int dst_w, int dst_h, RemapFilter filter, bool serpentine) {
+    memset(t, 0, sizeof(*t));
+    if (dst_w <= 0 || dst_h <= 0 || dst_w > REMAP_MAX_WIDTH || dst_h > REMAP_MAX_HEIGHT) {
+        return false;
+    }
+    const int src_w = WIDTH;
+    const int src_h = HEIGHT;
+    t->src_w = src_w;
+    t->src_h = src_h;
+    t->dst_w = dst_w;
+    t->dst_h = dst_h;
+
+    // Static: only used while building, which happens once at startup.
+    static AxisTaps cols[REMAP_MAX_WIDTH];
+    static AxisTaps rows[REMAP_MAX_HEIGHT];
+
+    size_t max_taps = 0;
+    int max_rows = 0;
+    for (int y = 0; y < dst_h; ++y) {
+        axis_taps(&rows[y], y, src_h, dst_h, filter);
+        max_rows = rows[y].count > max_rows ? rows[y].count : max_rows;
+    }
+    for (int x = 0; x < dst_w; ++x) {
+        axis_taps(&cols[x], x, src_w, dst_w, filter);
+        max_taps += (size_t)cols[x].count * (size_t)max_rows * (size_t)dst_h;
+    }
+
+    const size_t pixels = (size_t)dst_w * (size_t)dst_h;
+    t->first = malloc((pixels + 1) * sizeof(*t->first));
+    t->src = malloc(max_taps * sizeof(*t->src));
+    t->weight = malloc(max_taps * sizeof(*t->weight));
+    if (!t->first || !t->src || !t->weight) {
+        fprintf(stderr, "Out of memory for the remap table\n");
+        remap_free(t);
+        return false;
+    }
+
+    const uint64_t area = (uint64_t)src_w * (uint64_t)src_h; // units covered by one output pixel
+    uint32_t n = 0;
+    for (int y = 0; y < dst_h; ++y) {
+        for (int k = 0; k < dst_w; ++k) {
+            // Output order; serpentine rows run right to left every other row.
+            const int x = serpentine && (y & 1) ? dst_w - 1 - k : k;
+            const AxisTaps *cx = &cols[x];
+            const AxisTaps *ry = &rows[y];
+
+            t->first[(size_t)y * dst_w + k] = n;
+            // Weights come from the running total of coverage, so they sum to
+            // exactly WEIGHT_ONE and flat areas stay flat.
+            uint64_t covered = 0;
+            uint32_t assigned = 0;
+            for (int j = 0; j < ry->count; ++j) {
+                for (int i = 0; i < cx->count; ++i) {
+                    covered += (uint64_t)cx->overlap[i] * (uint64_t)ry->overlap[j];
+                    const uint32_t w = (uint32_t)((covered * WEIGHT_ONE + area / 2) / area) - assigned;
+                    if (w == 0) {
+                        continue;
+                    }
+                    t->src[n] = (uint16_t)((ry->first + j) * src_w + cx->first + i);
+                    t->weight[n] = (uint16_t)w;
+                    assigned += w;
+                    n++;
+                }
+            }
+        }
+    }
+    t->first[pixels] = n;
+    t->tap_count = n;
+    t->single_tap = n == pixels;
+    return true;
+}
+
+size_t remap_frame_size(const RemapTable *t) {
+    return (size_t)t->dst_w * (size_t)t->dst_h * 2;
+}
+
+void remap_apply(const RemapTable *t, const unsigned char *src, unsigned char *dst) {
+    const int pixels = t->dst_w * t->dst_h;
+
+    if (t->single_tap) {
+        for (int i = 0; i < pixels; ++i) {
+            const unsigned char *p = src + (size_t)t->src[i] * 2;
+            dst[i * 2] = p[0];
+            dst[i * 2 + 1] = p[1];
+        }
+        return;
+    }
+
+    for (int i = 0; i < pixels; ++i) {
+        uint32_t r = 0;
+        uint32_t g = 0;
+        uint32_t b = 0;
+        for (uint32_t j = t->first[i]; j < t->first[i + 1]; ++j) {
+            const uint32_t px = rgb565_at(src + (size_t)t->src[j] * 2);
+            const uint32_t w = t->weight[j];
+            r += (px >> 11) * w;
+            g += ((px >> 5) & 0x3F) * w;
+            b += (px & 0x1F) * w;
+        }
+        const uint32_t half = WEIGHT_ONE / 2;
+        const uint16_t out = (uint16_t)(((r + half) >> REMAP_WEIGHT_BITS) << 11 |
+                                        ((g + half) >> REMAP_WEIGHT_BITS) << 5 |
+                                        ((b + half) >> REMAP_WEIGHT_BITS));
+        dst[i * 2] = (unsigned char)(out >> 8);
+        dst[i * 2 + 1] = (unsigned char)out;
+    }
+}
+
+void remap_free(RemapTable *t) {
+    free(t->first);
+    free(t->src);
+    free(t->weight);
+    memset(t, 0, sizeof(*t));
+}
+
+const char *remap_filter_name(RemapFilter filter) {
+    switch (filter) {
+        case REMAP_FILTER_NEAREST:
+            return "nearest";
+        case REMAP_FILTER_BOX:
+            return "box";
+    }
+    return "unknown";
+}
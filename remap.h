@@ -0,0 +1,52 @@
+/*
+
+Copyright 2025 Marc Ketel
+SPDX-License-Identifier: Apache-2.0
+
+*/
+
+/*
+ * Geometry remapping from the 80x8 stream to another matrix.
+ *
+ * A table built once per configuration lists, for every output pixel in
+ * output order, the source pixels it is made of and their weights. Nearest
+ * sampling is one tap per pixel; box filtering averages every source pixel
+ * the output pixel covers, weighted by the area it covers. Serpentine order
+ * reverses every other row, for matrices wired back and forth.
+ *
+ * Remapping a frame is then a single gather pass over the table.
+ */
+
+#ifndef REMAP_H
+#define REMAP_H
+
+#include "config.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define REMAP_WEIGHT_BITS 14 // weights of one output pixel sum to 1 << REMAP_WEIGHT_BITS
+
+typedef struct RemapTable {
+    int src_w; // always the stream's WIDTH x HEIGHT
+    int src_h;
+    int dst_w;
+    int dst_h;
+    bool single_tap; // every output pixel copies one source pixel
+
+    uint32_t *first;  // dst_w * dst_h + 1 offsets into src/weight
+    uint16_t *src;    // source pixel index per tap
+    uint16_t *weight; // per tap, unused when single_tap
+    uint32_t tap_count;
+} RemapTable;
+
+// Table from the WIDTH x HEIGHT stream to a dst_w x dst_h matrix.
+bool remap_build(RemapTable *t, int dst_w, int dst_h, RemapFilter filter, bool serpentine);
+size_t remap_frame_size(const RemapTable *t); // bytes of an output frame
+void remap_apply(const RemapTable *t, const unsigned char *src, unsigned char *dst);
+void remap_free(RemapTable *t);
+
+const char *remap_filter_name(RemapFilter filter);
+
+#endif // REMAP_H
@@ -0,0 +1,522 @@
+/*
+
+Copyright 2025 Marc Ketel
+SPDX-License-Identifier: Apache-2.0
+
+*/
+
+/*
+ * Render path microbenchmark.
+ *
+ * Renders synthetic and recorded frames through every available render
+ * path (the window surface path plus the renderer path on each SDL render
+ * driver that can be created) at several window sizes, and reports the
+ * decode, draw and present time per frame as percentiles.
+ *
+ * Uses SDL's offscreen video driver, falling back to dummy, so it runs on
+ * a plain Linux box without a display. Results are printed as a table and
+ * optionally written as JSON for comparing builds.
+ *
+ * Recorded frames are raw 1280-byte RGB565 frames concatenated in one file.
+ *
+ * With --remap every case renders the remapped matrix, and remap_apply()
+ * is first timed on its own for every scene.
+ */
+
+#include "config.h"
+#include "display.h"
+#include "options.h"
+#include "remap.h"
+
+#include <SDL3/SDL.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_BENCH_FRAMES 1000
+#define DEFAULT_WARMUP       50
+#define MAX_BENCH_FRAMES     1000000
+#define MAX_SCENES           8
+
+typedef struct BenchSize {
+    const char *name;
+    int width;
+    int height;
+} BenchSize;
+
+static const BenchSize bench_sizes[] = {
+    {"1x", WIDTH, HEIGHT},
+    {"8x", WIDTH * 8, HEIGHT * 8},
+    {"4k", 3840, 2160},
+};
+
+typedef struct BenchScene {
+    const char *name;
+    unsigned char *frames; // frame_count frames of MC_EXPECTED_SIZE bytes
+    size_t frame_count;
+} BenchScene;
+
+typedef struct Percentiles {
+    double mean;
+    double p50;
+    double p90;
+    double p99;
+    double max;
+} Percentiles;
+
+typedef struct BenchTimings {
+    Uint64 *decode_ns;
+    Uint64 *draw_ns;
+    Uint64 *present_ns;
+    Uint64 *total_ns;
+} BenchTimings;
+
+static void put_rgb565(unsigned char *frame, int x, int y, uint16_t color) {
+    size_t idx = (size_t)(y * WIDTH + x) * 2;
+    frame[idx] = (unsigned char)(color >> 8);
+    frame[idx + 1] = (unsigned char)(color & 0xFF);
+}
+
+// Synthetic scenes, each frame_count frames long (cycled if the run is longer):
+//   scroll: every LED row changes every frame (worst case for dirty rows)
+//   ticker: only the bottom row changes
+//   static: nothing changes after the first frame
+//   noise:  random pixels every frame
+static void fill_synthetic(BenchScene *scene, int kind, size_t frame_count) {
+    static unsigned int seed = 1;
+
+    for (size_t n = 0; n < frame_count; ++n) {
+        unsigned char *frame = &scene->frames[n * MC_EXPECTED_SIZE];
+        for (int y = 0; y < HEIGHT; ++y) {
+            for (int x = 0; x < WIDTH; ++x) {
+                int shift = (int)n;
+                if (kind == 2 || (kind == 1 && y != HEIGHT - 1)) {
+                    shift = 0;
+                }
+                uint16_t color = (uint16_t)(((x + shift) * 2063 + y * 977) & 0xFFFF);
+                if (kind == 3) {
+                    seed = seed * 1103515245u + 12345u;
+                    color = (uint16_t)(seed >> 16);
+                }
+                put_rgb565(frame, x, y, color);
+            }
+        }
+    }
+}
+
+static bool add_synthetic_scenes(BenchScene *scenes, int *scene_count) {
+    static const char *names[] = {"scroll", "ticker", "static", "noise"};
+    const size_t frame_count = 256;
+
+    for (int kind = 0; kind < 4; ++kind) {
+        BenchScene *scene = &scenes[(*scene_count)];
+        scene->name = names[kind];
+        scene->frame_count = frame_count;
+        scene->frames = malloc(frame_count * MC_EXPECTED_SIZE);
+        if (!scene->frames) {
+            perror("malloc");
+            return false;
+        }
+        fill_synthetic(scene, kind, frame_count);
+        (*scene_count)++;
+    }
+    return true;
+}
+
+static bool load_recorded_scene(const char *path, BenchScene *scene) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+
+    size_t capacity = 0;
+    scene->name = path;
+    scene->frames = NULL;
+    scene->frame_count = 0;
+
+    for (;;) {
+        if (scene->frame_count == capacity) {
+            capacity = capacity ? capacity * 2 : 256;
+            unsigned char *grown = realloc(scene->frames, capacity * MC_EXPECTED_SIZE);
+            if (!grown) {
+                perror("realloc");
+                fclose(f);
+                return false;
+            }
+            scene->frames = grown;
+        }
+
+        unsigned char *frame = &scene->frames[scene->frame_count * MC_EXPECTED_SIZE];
+        if (fread(frame, 1, MC_EXPECTED_SIZE, f) != MC_EXPECTED_SIZE) {
+            break;
+        }
+        scene->frame_count++;
+    }
+    fclose(f);
+
+    if (scene->frame_count == 0) {
+        fprintf(stderr, "%s: no complete %d-byte frames found\n", path, MC_EXPECTED_SIZE);
+        return false;
+    }
+    return true;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    Uint64 x = *(const Uint64 *)a;
+    Uint64 y = *(const Uint64 *)b;
+    return (x > y) - (x < y);
+}
+
+// Sorts samples in place; results are in microseconds.
+static Percentiles compute_percentiles(Uint64 *samples, int count) {
+    Percentiles p = {0};
+    if (count <= 0) {
+        return p;
+    }
+
+    qsort(samples, (size_t)count, sizeof(samples[0]), compare_u64);
+
+    double sum = 0.0;
+    for (int i = 0; i < count; ++i) {
+        sum += (double)samples[i];
+    }
+
+    p.mean = sum / count / 1000.0;
+    p.p50 = (double)samples[(count - 1) * 50 / 100] / 1000.0;
+    p.p90 = (double)samples[(count - 1) * 90 / 100] / 1000.0;
+    p.p99 = (double)samples[(count - 1) * 99 / 100] / 1000.0;
+    p.max = (double)samples[count - 1] / 1000.0;
+    return p;
+}
+
+static void json_percentiles(FILE *out, const char *name, const Percentiles *p, bool last) {
+    fprintf(out,
+            "      \"%s\": {\"mean\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f}%s\n",
+            name, p->mean, p->p50, p->p90, p->p99, p->max, last ? "" : ",");
+}
+
+static void json_string(FILE *out, const char *s) {
+    fputc('"', out);
+    for (; *s; ++s) {
+        if (*s == '"' || *s == '\\') {
+            fputc('\\', out);
+        }
+        if ((unsigned char)*s >= 0x20) {
+            fputc(*s, out);
+        }
+    }
+    fputc('"', out);
+}
+
+typedef struct CaseInfo {
+    char driver[64];       // renderer name, or "surface"
+    char video_driver[32]; // SDL video driver in use
+    char skipped[160];     // why run_case() returned false
+} CaseInfo;
+
+static bool run_case(const AppConfig *config,
+                     const BenchScene *scene,
+                     int frames,
+                     int warmup,
+                     BenchTimings *t,
+                     CaseInfo *info) {
+    Display display;
+    if (!init_sdl(config, &display)) {
+        // Remap and colour table failures have printed their reason already.
+        const char *error = SDL_GetError();
+        SDL_snprintf(info->skipped, sizeof(info->skipped), "%s", error && error[0] ? error : "setup failed");
+        return false;
+    }
+
+    const char *video_driver = SDL_GetCurrentVideoDriver();
+    SDL_snprintf(info->video_driver, sizeof(info->video_driver), "%s", video_driver ? video_driver : "unknown");
+    if (display.renderer) {
+        SDL_snprintf(info->driver, sizeof(info->driver), "%s", SDL_GetRendererName(display.renderer));
+    } else {
+        SDL_snprintf(info->driver, sizeof(info->driver), "%s", "surface");
+    }
+
+    // A forced driver name that SDL silently swapped or that AUTO turned
+    // into the surface path would be reported under the wrong label.
+    bool usable = (config->render_path == RENDER_PATH_SURFACE) == (display.path == RENDER_PATH_SURFACE);
+    if (!usable) {
+        SDL_snprintf(info->skipped,
+                     sizeof(info->skipped),
+                     "asked for %s, got %s",
+                     config->render_driver ? config->render_driver : "the surface path",
+                     display.path == RENDER_PATH_SURFACE ? "the surface path" : info->driver);
+    }
+
+    for (int i = 0; usable && i < warmup + frames; ++i) {
+        const unsigned char *frame = &scene->frames[(size_t)i % scene->frame_count * MC_EXPECTED_SIZE];
+
+        Uint64 t0 = SDL_GetTicksNS();
+        bool have = display_decode(&display, frame, MC_EXPECTED_SIZE);
+        Uint64 t1 = SDL_GetTicksNS();
+        if (have) {
+            display_draw(&display);
+        }
+        Uint64 t2 = SDL_GetTicksNS();
+        if (have) {
+            display_present(&display);
+        }
+        Uint64 t3 = SDL_GetTicksNS();
+
+        if (i >= warmup) {
+            int s = i - warmup;
+            t->decode_ns[s] = t1 - t0;
+            t->draw_ns[s] = t2 - t1;
+            t->present_ns[s] = t3 - t2;
+            t->total_ns[s] = t3 - t0;
+        }
+    }
+
+    shutdown_sdl(&display);
+    return usable;
+}
+
+// remap_apply() on its own: no SDL involved, so this needs no window.
+static bool bench_remap(FILE *table, const AppConfig *config, const BenchScene *scenes, int scene_count, int frames, int warmup, Uint64 *samples) {
+    RemapTable remap;
+    if (!remap_build(&remap, config->remap_width, config->remap_height, config->remap_filter, config->remap_serpentine)) {
+        return false;
+    }
+
+    // Static: up to REMAP_MAX_FRAME_SIZE bytes.
+    static unsigned char out[REMAP_MAX_FRAME_SIZE];
+    fprintf(table,
+            "remap to %dx%d, %s%s, %u taps: remap_apply() us p50/p90/p99\n",
+            remap.dst_w,
+            remap.dst_h,
+            remap_filter_name(config->remap_filter),
+            config->remap_serpentine ? ", serpentine" : "",
+            remap.tap_count);
+    for (int s = 0; s < scene_count; ++s) {
+        for (int i = 0; i < warmup + frames; ++i) {
+            const unsigned char *frame = &scenes[s].frames[(size_t)i % scenes[s].frame_count * MC_EXPECTED_SIZE];
+            Uint64 t0 = SDL_GetTicksNS();
+            remap_apply(&remap, frame, out);
+            Uint64 t1 = SDL_GetTicksNS();
+            if (i >= warmup) {
+                samples[i - warmup] = t1 - t0;
+            }
+        }
+        Percentiles p = compute_percentiles(samples, frames);
+        fprintf(table, "  %-24.24s %9.2f/%9.2f/%9.2f\n", scenes[s].name, p.p50, p.p90, p.p99);
+    }
+    fprintf(table, "\n");
+    fflush(table);
+
+    remap_free(&remap);
+    return true;
+}
+
+static void print_usage(FILE *out, const char *prog) {
+    fprintf(out,
+            "Usage: %s [options]\n"
+            "\n"
+            "Options:\n"
+            "  -n, --frames N       measured frames per case (default: %d)\n"
+            "  -w, --warmup N       unmeasured frames before each case (default: %d)\n"
+            "  -f, --frames-file F  add a scene from recorded raw RGB565 frames (repeatable)\n"
+            "  -j, --json FILE      write results as JSON to FILE (- for stdout)\n"
+            "  -r, --remap SPEC     time remap_apply() and render the remapped matrix,\n"
+            "                       SPEC as for led80x8 --remap: WxH[,nearest|box][,serpentine]\n"
+            "  -h, --help           show this help and exit\n",
+            prog, DEFAULT_BENCH_FRAMES, DEFAULT_WARMUP);
+}
+
+int main(int argc, char **argv) {
+    static const struct option long_options[] = {
+        {"frames", required_argument, NULL, 'n'},
+        {"warmup", required_argument, NULL, 'w'},
+        {"frames-file", required_argument, NULL, 'f'},
+        {"json", required_argument, NULL, 'j'},
+        {"remap", required_argument, NULL, 'r'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+
+    int frames = DEFAULT_BENCH_FRAMES;
+    int warmup = DEFAULT_WARMUP;
+    const char *json_path = NULL;
+    AppConfig remap_config = DEFAULT_APPCONFIG; // remap_* fields only
+
+    BenchScene scenes[MAX_SCENES];
+    int scene_count = 0;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "n:w:f:j:r:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'n':
+                if (!parse_int(optarg, 1, MAX_BENCH_FRAMES, &frames)) {
+                    fprintf(stderr, "Invalid frame count: %s (expected 1-%d)\n", optarg, MAX_BENCH_FRAMES);
+                    return 1;
+                }
+                break;
+            case 'w':
+                if (!parse_int(optarg, 0, MAX_BENCH_FRAMES, &warmup)) {
+                    fprintf(stderr, "Invalid warmup: %s (expected 0-%d)\n", optarg, MAX_BENCH_FRAMES);
+                    return 1;
+                }
+                break;
+            case 'f':
+                if (scene_count >= MAX_SCENES - 4) {
+                    fprintf(stderr, "Too many frame files (max %d)\n", MAX_SCENES - 4);
+                    return 1;
+                }
+                if (!load_recorded_scene(optarg, &scenes[scene_count])) {
+                    return 1;
+                }
+                scene_count++;
+                break;
+            case 'j':
+                json_path = optarg;
+                break;
+            case 'r':
+                if (!parse_remap(optarg, &remap_config)) {
+                    fprintf(stderr, "Invalid remap: %s (expected WxH[,nearest|box][,serpentine])\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'h':
+                print_usage(stdout, argv[0]);
+                return 0;
+            default:
+                print_usage(stderr, argv[0]);
+                return 1;
+        }
+    }
+
+    if (!add_synthetic_scenes(scenes, &scene_count)) {
+        return 1;
+    }
+
+    // Headless: try the offscreen driver first, then dummy.
+    SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen,dummy");
+
+    // Render paths: the surface path plus the renderer path on every render
+    // driver SDL was built with. Drivers that cannot be created on this
+    // video driver are skipped.
+    int driver_count = SDL_GetNumRenderDrivers();
+    if (driver_count < 0) {
+        driver_count = 0;
+    }
+
+    BenchTimings t;
+    t.decode_ns = malloc((size_t)frames * sizeof(Uint64));
+    t.draw_ns = malloc((size_t)frames * sizeof(Uint64));
+    t.present_ns = malloc((size_t)frames * sizeof(Uint64));
+    t.total_ns = malloc((size_t)frames * sizeof(Uint64));
+    if (!t.decode_ns || !t.draw_ns || !t.present_ns || !t.total_ns) {
+        perror("malloc");
+        return 1;
+    }
+
+    FILE *json = NULL;
+    if (json_path) {
+        json = strcmp(json_path, "-") == 0 ? stdout : fopen(json_path, "w");
+        if (!json) {
+            perror(json_path);
+            return 1;
+        }
+    }
+
+    bool first_result = true;
+
+    // Table goes to stderr when JSON goes to stdout.
+    FILE *table = (json == stdout) ? stderr : stdout;
+
+    if (remap_config.remap_width > 0 &&
+        !bench_remap(table, &remap_config, scenes, scene_count, frames, warmup, t.total_ns)) {
+        return 1; // remap_build() said why
+    }
+    fprintf(table,
+            "%-10s %-5s %-24s %33s %33s %33s\n",
+            "path", "size", "scene",
+            "decode us p50/p90/p99", "draw us p50/p90/p99", "present us p50/p90/p99");
+
+    for (size_t z = 0; z < sizeof(bench_sizes) / sizeof(bench_sizes[0]); ++z) {
+        for (int d = -1; d < driver_count; ++d) {
+            AppConfig config = DEFAULT_APPCONFIG;
+            config.window_width = bench_sizes[z].width;
+            config.window_height = bench_sizes[z].height;
+            config.remap_width = remap_config.remap_width;
+            config.remap_height = remap_config.remap_height;
+            config.remap_filter = remap_config.remap_filter;
+            config.remap_serpentine = remap_config.remap_serpentine;
+            if (d < 0) {
+                config.render_path = RENDER_PATH_SURFACE;
+            } else {
+                config.render_path = RENDER_PATH_RENDERER;
+                config.render_driver = SDL_GetRenderDriver(d);
+            }
+
+            for (int s = 0; s < scene_count; ++s) {
+                CaseInfo info;
+                if (!run_case(&config, &scenes[s], frames, warmup, &t, &info)) {
+                    fprintf(table, "%-10s %-5s skipped: %s\n",
+                            config.render_driver ? config.render_driver : "surface",
+                            bench_sizes[z].name,
+                            info.skipped);
+                    break;
+                }
+                Percentiles dec = compute_percentiles(t.decode_ns, frames);
+                Percentiles drw = compute_percentiles(t.draw_ns, frames);
+                Percentiles pre = compute_percentiles(t.present_ns, frames);
+                Percentiles tot = compute_percentiles(t.total_ns, frames);
+
+                fprintf(table,
+                        "%-10s %-5s %-24.24s %11.2f/%9.2f/%9.2f %11.2f/%9.2f/%9.2f %11.2f/%9.2f/%9.2f\n",
+                        info.driver, bench_sizes[z].name, scenes[s].name,
+                        dec.p50, dec.p90, dec.p99,
+                        drw.p50, drw.p90, drw.p99,
+                        pre.p50, pre.p90, pre.p99);
+
+                if (json) {
+                    if (first_result) {
+                        fprintf(json,
+                                "{\n  \"video_driver\": \"%s\",\n  \"frames\": %d,\n  \"warmup\": %d,\n  \"results\": [\n",
+                                info.video_driver, frames, warmup);
+                    }
+                    fprintf(json,
+                            "%s    {\n"
+                            "      \"path\": \"%s\",\n"
+                            "      \"driver\": \"%s\",\n"
+                            "      \"size\": \"%s\",\n"
+                            "      \"width\": %d,\n"
+                            "      \"height\": %d,\n"
+                            "      \"scene\": ",
+                            first_result ? "" : ",\n",
+                            render_path_name(config.render_path),
+                            info.driver,
+                            bench_sizes[z].name,
+                            bench_sizes[z].width,
+                            bench_sizes[z].height);
+                    json_string(json, scenes[s].name);
+                    fprintf(json, ",\n");
+                    json_percentiles(json, "decode_us", &dec, false);
+                    json_percentiles(json, "draw_us", &drw, false);
+                    json_percentiles(json, "present_us", &pre, false);
+                    json_percentiles(json, "total_us", &tot, true);
+                    fprintf(json, "    }");
+                }
+                first_result = false;
+            }
+        }
+    }
+
+    if (json) {
+        if (first_result) {
+            fprintf(json, "{\n  \"results\": [");
+        }
+        fprintf(json, "\n  ]\n}\n");
+        if (json != stdout) {
+            fclose(json);
+        }
+    }
+
+    return first_result ? 1 : 0;
+}
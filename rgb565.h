@@ -0,0 +1,24 @@
+/*
+
+Copyright 2025 Marc Ketel
+SPDX-License-Identifier: Apache-2.0
+
+*/
+
+#ifndef RGB565_H
+#define RGB565_H
+
+#include <stdint.h>
+
+// Frames are big-endian RGB565, as on the wire; the value is also the
+// colour table index.
+static inline uint16_t rgb565_at(const unsigned char *p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static inline void rgb565_put(unsigned char *p, uint16_t v) {
+    p[0] = (unsigned char)(v >> 8);
+    p[1] = (unsigned char)v;
+}
+
+#endif // RGB565_H
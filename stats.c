@@ -7,10 +7,12 @@ SPDX-License-Identifier: Apache-2.0
 
 #include "stats.h"
 
+#include <arpa/inet.h>
 #include <stdio.h>
+#include <sys/resource.h>
 #include <time.h>
 
-void print_timestamp_size_fps_kbps(ssize_t n, double fps, double averaged_fps, double kbps) {
+void print_timestamp_size_fps_kbps(const StatsState *stats, ssize_t n, double fps, double averaged_fps, double kbps) {
     struct timespec ts;
     clock_gettime(CLOCK_REALTIME, &ts);
 
@@ -20,22 +22,37 @@ void print_timestamp_size_fps_kbps(ssize_t n, double fps, double averaged_fps, d
     char buf[64];
     strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &tm_local);
 
-    printf("%s.%03ld: received %zd bytes, %6.2f FPS, %6.2f FPS (avg), %7.2f kB/s\n",
+    printf("%s.%03ld: received %zd bytes, %6.2f FPS, %6.2f FPS (avg), %7.2f kB/s",
            buf,
            ts.tv_nsec / 1000000,
            n,
            fps,
            averaged_fps,
            kbps);
+    if (stats->governor_level) {
+        printf(", governor %s, %lu coalesced", stats->governor_level, stats->coalesced);
+    }
+    printf("\n");
     fflush(stdout);
 }
 
+void stats_set_governor(StatsState *stats, const char *level, unsigned long coalesced) {
+    stats->governor_level = level;
+    stats->coalesced = coalesced;
+}
+
 void update_stats_and_log(StatsState *stats, ssize_t n) {
     struct timespec now;
     clock_gettime(CLOCK_MONOTONIC, &now);
 
     stats->bytes_since_last += (size_t)n;
 
+    if (stats->total_frames == 0) {
+        stats->first_ts = now;
+    }
+    stats->total_frames++;
+    stats->total_bytes += (unsigned long long)n;
+
     double fps = 0.0;
     double averaged_fps = 0.0;
     double kbps = 0.0;
@@ -78,9 +95,172 @@ void update_stats_and_log(StatsState *stats, ssize_t n) {
     stats->have_last_ts = 1;
 
     if (fps > 0.0) {
-        print_timestamp_size_fps_kbps(n, fps, averaged_fps, kbps);
+        print_timestamp_size_fps_kbps(stats, n, fps, averaged_fps, kbps);
         stats->bytes_since_last = 0;
     } else {
-        print_timestamp_size_fps_kbps(n, 0.0, 0.0, 0.0);
+        print_timestamp_size_fps_kbps(stats, n, 0.0, 0.0, 0.0);
+    }
+}
+
+static int latency_bucket(unsigned long long ns) {
+    if (ns < (1ULL << LATENCY_SUB_BITS)) {
+        return (int)ns;
+    }
+
+    int exp = 63 - __builtin_clzll(ns);
+    if (exp > LATENCY_MAX_EXP) {
+        return LATENCY_BUCKETS - 1;
+    }
+
+    int sub = (int)((ns >> (exp - LATENCY_SUB_BITS)) & ((1U << LATENCY_SUB_BITS) - 1));
+    return ((exp - LATENCY_SUB_BITS + 1) << LATENCY_SUB_BITS) + sub;
+}
+
+// Upper bound of a bucket, so percentiles never understate the tail.
+static unsigned long long latency_bucket_high(int idx) {
+    if (idx < (1 << LATENCY_SUB_BITS)) {
+        return (unsigned long long)idx;
+    }
+
+    int exp = (idx >> LATENCY_SUB_BITS) + LATENCY_SUB_BITS - 1;
+    unsigned long long sub = (unsigned long long)(idx & ((1 << LATENCY_SUB_BITS) - 1));
+    unsigned long long width = 1ULL << (exp - LATENCY_SUB_BITS);
+    return (((1ULL << LATENCY_SUB_BITS) + sub) << (exp - LATENCY_SUB_BITS)) + width - 1;
+}
+
+void latency_record(LatencyHistogram *h, long long ns) {
+    if (ns < 0) {
+        // Clock adjustments between the kernel timestamp and now.
+        ns = 0;
+    }
+
+    unsigned long long v = (unsigned long long)ns;
+    h->counts[latency_bucket(v)]++;
+    h->total++;
+    h->sum_ns += v;
+    if (v > h->max_ns) {
+        h->max_ns = v;
+    }
+}
+
+unsigned long long latency_percentile(const LatencyHistogram *h, double pct) {
+    if (h->total == 0) {
+        return 0;
+    }
+
+    unsigned long long rank = (unsigned long long)(pct / 100.0 * (double)h->total + 0.5);
+    if (rank < 1) {
+        rank = 1;
+    }
+
+    unsigned long long seen = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; ++i) {
+        seen += h->counts[i];
+        if (seen >= rank) {
+            unsigned long long high = latency_bucket_high(i);
+            return high < h->max_ns ? high : h->max_ns;
+        }
+    }
+    return h->max_ns;
+}
+
+void print_latency_summary(const LatencyHistogram *h, const char *label) {
+    if (h->total == 0) {
+        return;
+    }
+
+    printf("  %s latency (us): mean %.1f, p50 %.1f, p90 %.1f, p99 %.1f, p99.9 %.1f, max %.1f (%lu samples)\n",
+           label,
+           (double)h->sum_ns / (double)h->total / 1e3,
+           latency_percentile(h, 50.0) / 1e3,
+           latency_percentile(h, 90.0) / 1e3,
+           latency_percentile(h, 99.0) / 1e3,
+           latency_percentile(h, 99.9) / 1e3,
+           h->max_ns / 1e3,
+           h->total);
+}
+
+static long long timespec_diff_ns(const struct timespec *later, const struct timespec *earlier) {
+    return (long long)(later->tv_sec - earlier->tv_sec) * 1000000000LL + (later->tv_nsec - earlier->tv_nsec);
+}
+
+void stats_record_latency(StatsState *stats,
+                          const struct timespec *rx_ts,
+                          const struct timespec *picked_ts,
+                          const struct timespec *shown_ts) {
+    latency_record(&stats->rx_latency, timespec_diff_ns(picked_ts, rx_ts));
+    latency_record(&stats->display_latency, timespec_diff_ns(shown_ts, rx_ts));
+}
+
+void stats_record_source(StatsState *stats, const struct sockaddr_in *src, size_t len) {
+    SourceStats *entry = NULL;
+    for (int i = 0; i < stats->source_count; ++i) {
+        if (stats->sources[i].addr.s_addr == src->sin_addr.s_addr) {
+            entry = &stats->sources[i];
+            break;
+        }
+    }
+
+    if (!entry) {
+        char addr[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &src->sin_addr, addr, sizeof(addr));
+        if (stats->source_count < STATS_MAX_SOURCES) {
+            entry = &stats->sources[stats->source_count++];
+            entry->addr = src->sin_addr;
+            printf("New sender: %s:%u\n", addr, ntohs(src->sin_port));
+        } else {
+            entry = &stats->other_sources;
+        }
+    }
+
+    entry->packets++;
+    entry->bytes += len;
+}
+
+static void print_source_summary(const StatsState *stats) {
+    for (int i = 0; i < stats->source_count; ++i) {
+        char addr[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &stats->sources[i].addr, addr, sizeof(addr));
+        printf("  source %s: %lu packets, %llu bytes\n", addr, stats->sources[i].packets, stats->sources[i].bytes);
     }
-}
\ No newline at end of file
+    if (stats->other_sources.packets > 0) {
+        printf("  other sources: %lu packets, %llu bytes\n", stats->other_sources.packets, stats->other_sources.bytes);
+    }
+}
+
+static double timeval_ms(struct timeval tv) {
+    return tv.tv_sec * 1e3 + tv.tv_usec / 1e3;
+}
+
+void print_receive_summary(const StatsState *stats, const char *backend, unsigned long syscalls) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    double user_ms = timeval_ms(ru.ru_utime);
+    double sys_ms = timeval_ms(ru.ru_stime);
+
+    double wall = 0.0;
+    if (stats->total_frames > 0) {
+        wall = (now.tv_sec - stats->first_ts.tv_sec) + (now.tv_nsec - stats->first_ts.tv_nsec) / 1e9;
+    }
+
+    double frames = (double)stats->total_frames;
+    printf("Receive summary (%s): %lu frames, %llu bytes in %.1f s\n",
+           backend,
+           stats->total_frames,
+           stats->total_bytes,
+           wall);
+    printf("  receive syscalls: %lu total, %.2f per frame\n",
+           syscalls,
+           frames > 0 ? syscalls / frames : 0.0);
+    printf("  process CPU: %.1f ms user, %.1f ms sys, %.3f ms per frame\n",
+           user_ms,
+           sys_ms,
+           frames > 0 ? (user_ms + sys_ms) / frames : 0.0);
+    print_latency_summary(&stats->rx_latency, "receive");
+    print_latency_summary(&stats->display_latency, "display");
+    print_source_summary(stats);
+    fflush(stdout);
+}
@@ -8,12 +8,35 @@ SPDX-License-Identifier: Apache-2.0
 #ifndef STATS_H
 #define STATS_H
 
+#include <netinet/in.h>
 #include <stddef.h>
 #include <sys/types.h>
 #include <time.h>
 
 #define FPS_AVERAGE_FRAMES 42
 
+// Log-linear latency histogram in nanoseconds: 16 buckets per power of
+// two (about 6% resolution) up to 2^40 ns, fixed size, no allocation.
+#define LATENCY_SUB_BITS 4
+#define LATENCY_MAX_EXP  40
+#define LATENCY_BUCKETS  ((LATENCY_MAX_EXP - LATENCY_SUB_BITS + 2) << LATENCY_SUB_BITS)
+
+typedef struct LatencyHistogram {
+    unsigned long counts[LATENCY_BUCKETS];
+    unsigned long total;
+    unsigned long long sum_ns;
+    unsigned long long max_ns;
+} LatencyHistogram;
+
+// Senders tracked individually; anything beyond that is counted together.
+#define STATS_MAX_SOURCES 16
+
+typedef struct SourceStats {
+    struct in_addr addr;
+    unsigned long packets;
+    unsigned long long bytes;
+} SourceStats;
+
 typedef struct StatsState {
     struct timespec last_ts;
     int have_last_ts;
@@ -21,9 +44,38 @@ typedef struct StatsState {
     struct timespec frame_timestamps[FPS_AVERAGE_FRAMES];
     int frame_count;
     int frame_index;
+
+    // Totals for the exit summary.
+    struct timespec first_ts;
+    unsigned long total_frames;
+    unsigned long long total_bytes;
+
+    // Kernel receive timestamp to the loop picking the frame up, and to
+    // the frame having been presented.
+    LatencyHistogram rx_latency;
+    LatencyHistogram display_latency;
+
+    // Datagrams per sender, including ones with an unexpected size.
+    SourceStats sources[STATS_MAX_SOURCES];
+    int source_count;
+    SourceStats other_sources;
+
+    // Overload governor state, logged with every frame.
+    const char *governor_level; // NULL = governor off
+    unsigned long coalesced;
 } StatsState;
 
-void print_timestamp_size_fps_kbps(ssize_t n, double fps, double averaged_fps, double kbps);
+void print_timestamp_size_fps_kbps(const StatsState *stats, ssize_t n, double fps, double averaged_fps, double kbps);
 void update_stats_and_log(StatsState *stats, ssize_t n);
+void stats_set_governor(StatsState *stats, const char *level, unsigned long coalesced);
+void latency_record(LatencyHistogram *h, long long ns);
+unsigned long long latency_percentile(const LatencyHistogram *h, double pct);
+void print_latency_summary(const LatencyHistogram *h, const char *label);
+void stats_record_latency(StatsState *stats,
+                          const struct timespec *rx_ts,
+                          const struct timespec *picked_ts,
+                          const struct timespec *shown_ts);
+void stats_record_source(StatsState *stats, const struct sockaddr_in *src, size_t len);
+void print_receive_summary(const StatsState *stats, const char *backend, unsigned long syscalls);
 
 #endif // STATS_H
\ No newline at end of file
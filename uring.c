@@ -0,0 +1,366 @@
+/*
+
+Copyright 2025 Marc Ketel
+SPDX-License-Identifier: Apache-2.0
+
+*/
+
+/*
+ * io_uring receive backend.
+ *
+ * A single multishot IORING_OP_RECVMSG stays armed on the multicast socket
+ * and picks its buffers from a registered provided-buffer ring. Completed
+ * datagrams are read straight out of the ring slot by the decode/render
+ * stage and the slot goes back to the kernel once released, so there is
+ * no copy into a receive buffer and, in steady state, no syscall at all:
+ * completions show up in the mapped CQ ring on their own.
+ *
+ * Talks to the kernel through the raw syscalls so there is no liburing
+ * dependency. Needs Linux 6.0 for multishot recvmsg; anything older fails
+ * in setup or on the first completion and the caller falls back to the
+ * plain socket path.
+ */
+
+#include "uring.h"
+#include "config.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if defined(__linux__) && defined(__NR_io_uring_setup)
+#include <linux/io_uring.h>
+#endif
+
+// IORING_RECV_MULTISHOT (Linux 6.0 headers) implies IORING_REGISTER_PBUF_RING (5.19).
+#if defined(IORING_RECV_MULTISHOT)
+
+#define URING_BUF_GROUP 0
+#define URING_RECV_TAG  1
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+static void recycle_slot(UringReceiver *ur, unsigned short bid) {
+    const unsigned short mask = URING_RING_ENTRIES - 1;
+    struct io_uring_buf *buf = &ur->buf_ring->bufs[ur->buf_tail & mask];
+    buf->addr = (unsigned long)(ur->slots + (size_t)bid * URING_SLOT_SIZE);
+    buf->len = URING_SLOT_SIZE;
+    buf->bid = bid;
+    ur->buf_tail++;
+    __atomic_store_n(&ur->buf_ring->tail, ur->buf_tail, __ATOMIC_RELEASE);
+}
+
+static bool arm_recvmsg(UringReceiver *ur) {
+    unsigned tail = *ur->sq_tail;
+    unsigned head = __atomic_load_n(ur->sq_head, __ATOMIC_ACQUIRE);
+    if (tail - head >= *ur->sq_mask + 1) {
+        return false;
+    }
+
+    unsigned idx = tail & *ur->sq_mask;
+    struct io_uring_sqe *sqe = &ur->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = ur->sock;
+    sqe->addr = (unsigned long)&ur->msg;
+    sqe->len = 1;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BUF_GROUP;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->user_data = URING_RECV_TAG;
+
+    ur->sq_array[idx] = idx;
+    __atomic_store_n(ur->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    ur->syscalls++;
+    if (sys_io_uring_enter(ur->ring_fd, 1, 0, 0) < 0) {
+        perror("io_uring_enter");
+        return false;
+    }
+
+    ur->armed = true;
+    return true;
+}
+
+static bool map_rings(UringReceiver *ur, const struct io_uring_params *p) {
+    ur->sq_len = p->sq_off.array + p->sq_entries * sizeof(unsigned);
+    ur->cq_len = p->cq_off.cqes + p->cq_entries * sizeof(struct io_uring_cqe);
+
+    bool single_mmap = (p->features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap && ur->cq_len > ur->sq_len) {
+        ur->sq_len = ur->cq_len;
+    }
+
+    ur->sq_ptr = mmap(NULL, ur->sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ur->ring_fd, IORING_OFF_SQ_RING);
+    if (ur->sq_ptr == MAP_FAILED) {
+        ur->sq_ptr = NULL;
+        return false;
+    }
+
+    if (single_mmap) {
+        ur->cq_ptr = ur->sq_ptr;
+    } else {
+        ur->cq_ptr = mmap(NULL, ur->cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ur->ring_fd, IORING_OFF_CQ_RING);
+        if (ur->cq_ptr == MAP_FAILED) {
+            ur->cq_ptr = NULL;
+            return false;
+        }
+    }
+
+    ur->sqes_len = p->sq_entries * sizeof(struct io_uring_sqe);
+    ur->sqes = mmap(NULL, ur->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ur->ring_fd, IORING_OFF_SQES);
+    if (ur->sqes == MAP_FAILED) {
+        ur->sqes = NULL;
+        return false;
+    }
+
+    unsigned char *sq = ur->sq_ptr;
+    ur->sq_head = (unsigned *)(sq + p->sq_off.head);
+    ur->sq_tail = (unsigned *)(sq + p->sq_off.tail);
+    ur->sq_mask = (unsigned *)(sq + p->sq_off.ring_mask);
+    ur->sq_array = (unsigned *)(sq + p->sq_off.array);
+    ur->sq_flags = (unsigned *)(sq + p->sq_off.flags);
+
+    unsigned char *cq = ur->cq_ptr;
+    ur->cq_head = (unsigned *)(cq + p->cq_off.head);
+    ur->cq_tail = (unsigned *)(cq + p->cq_off.tail);
+    ur->cq_mask = (unsigned *)(cq + p->cq_off.ring_mask);
+    ur->cqes = (struct io_uring_cqe *)(cq + p->cq_off.cqes);
+    return true;
+}
+
+static bool register_buffers(UringReceiver *ur) {
+    static_assert((URING_RING_ENTRIES & (URING_RING_ENTRIES - 1)) == 0,
+                  "URING_RING_ENTRIES must be a power of two");
+
+    // The ring itself must be page aligned; the slots live right behind it.
+    ur->buf_ring_len = URING_RING_ENTRIES * sizeof(struct io_uring_buf) +
+                       (size_t)URING_RING_ENTRIES * URING_SLOT_SIZE;
+    void *mem = mmap(NULL, ur->buf_ring_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (mem == MAP_FAILED) {
+        perror("mmap(io_uring buffers)");
+        return false;
+    }
+    ur->buf_ring = mem;
+    ur->slots = (unsigned char *)mem + URING_RING_ENTRIES * sizeof(struct io_uring_buf);
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (unsigned long)ur->buf_ring;
+    reg.ring_entries = URING_RING_ENTRIES;
+    reg.bgid = URING_BUF_GROUP;
+
+    ur->syscalls++;
+    if (sys_io_uring_register(ur->ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        fprintf(stderr, "io_uring: provided buffer ring not supported: %s\n", strerror(errno));
+        return false;
+    }
+
+    ur->buf_tail = 0;
+    for (unsigned short bid = 0; bid < URING_RING_ENTRIES; ++bid) {
+        recycle_slot(ur, bid);
+    }
+    return true;
+}
+
+bool uring_receiver_init(UringReceiver *ur, int sock, size_t control_len) {
+    memset(ur, 0, sizeof(*ur));
+    ur->ring_fd = -1;
+    ur->sock = sock;
+
+    if (sizeof(struct io_uring_recvmsg_out) + sizeof(struct sockaddr_in) + control_len + MC_BUF_SIZE > URING_SLOT_SIZE) {
+        fprintf(stderr, "io_uring: %zu bytes of control data do not fit in a buffer slot\n", control_len);
+        return false;
+    }
+
+    // Room in the CQ for every buffer slot: a burst between two polls must
+    // not overflow it, or the request's final completion ends up in the
+    // kernel's overflow list.
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = URING_CQ_ENTRIES;
+
+    ur->syscalls++;
+    ur->ring_fd = sys_io_uring_setup(8, &params);
+    if (ur->ring_fd < 0) {
+        fprintf(stderr, "io_uring: setup failed: %s\n", strerror(errno));
+        return false;
+    }
+
+    if (!map_rings(ur, &params)) {
+        perror("mmap(io_uring rings)");
+        uring_receiver_close(ur);
+        return false;
+    }
+
+    if (!register_buffers(ur)) {
+        uring_receiver_close(ur);
+        return false;
+    }
+
+    // Every slot gets the source address and control_len bytes of
+    // ancillary data in front of the payload.
+    ur->msg.msg_namelen = sizeof(struct sockaddr_in);
+    ur->msg.msg_controllen = control_len;
+
+    if (!arm_recvmsg(ur)) {
+        uring_receiver_close(ur);
+        return false;
+    }
+
+    printf("io_uring receive backend ready (%d x %d byte buffer slots)\n", URING_RING_ENTRIES, URING_SLOT_SIZE);
+    return true;
+}
+
+UringPollResult uring_receiver_poll(UringReceiver *ur, UringCompletion *out) {
+    // Out of buffers the request would end again right away, so it is only
+    // re-armed once a slot has come back.
+    if (!ur->armed && ur->held < URING_RING_ENTRIES && !arm_recvmsg(ur)) {
+        return URING_POLL_FAILED;
+    }
+
+    for (;;) {
+        unsigned head = *ur->cq_head;
+        unsigned tail = __atomic_load_n(ur->cq_tail, __ATOMIC_ACQUIRE);
+        if (head == tail) {
+            // Completions that did not fit in the CQ wait in the kernel
+            // until asked for.
+            if (!(__atomic_load_n(ur->sq_flags, __ATOMIC_ACQUIRE) & IORING_SQ_CQ_OVERFLOW)) {
+                return URING_POLL_EMPTY;
+            }
+            ur->syscalls++;
+            if (sys_io_uring_enter(ur->ring_fd, 0, 0, IORING_ENTER_GETEVENTS) < 0) {
+                perror("io_uring_enter");
+                return URING_POLL_FAILED;
+            }
+            continue;
+        }
+
+        const struct io_uring_cqe cqe = ur->cqes[head & *ur->cq_mask];
+        __atomic_store_n(ur->cq_head, head + 1, __ATOMIC_RELEASE);
+
+        if (!(cqe.flags & IORING_CQE_F_MORE)) {
+            // The multishot request ended (out of buffers, error, ...). It
+            // is re-armed on the next poll that has a free slot for it.
+            ur->armed = false;
+        }
+
+        if (cqe.res < 0) {
+            if (cqe.res == -ENOBUFS) {
+                continue;
+            }
+            if (!ur->delivered && cqe.res == -EINVAL) {
+                // Kernel without multishot recvmsg.
+                fprintf(stderr, "io_uring: multishot recvmsg not supported by this kernel\n");
+                return URING_POLL_FAILED;
+            }
+            fprintf(stderr, "io_uring: recvmsg failed: %s\n", strerror(-cqe.res));
+            continue;
+        }
+
+        if (!(cqe.flags & IORING_CQE_F_BUFFER)) {
+            continue;
+        }
+
+        int bid = (int)(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+        unsigned char *slot = ur->slots + (size_t)bid * URING_SLOT_SIZE;
+        const struct io_uring_recvmsg_out *hdr = (const struct io_uring_recvmsg_out *)slot;
+
+        const size_t name_off = sizeof(*hdr);
+        const size_t control_off = name_off + ur->msg.msg_namelen;
+        const size_t payload_off = control_off + ur->msg.msg_controllen;
+        if ((size_t)cqe.res < payload_off) {
+            recycle_slot(ur, (unsigned short)bid);
+            continue;
+        }
+
+        out->slot = bid;
+        out->name = slot + name_off;
+        out->name_len = hdr->namelen < ur->msg.msg_namelen ? hdr->namelen : ur->msg.msg_namelen;
+        out->control = slot + control_off;
+        out->control_len = hdr->controllen < ur->msg.msg_controllen ? hdr->controllen : ur->msg.msg_controllen;
+
+        // payloadlen is the full datagram length; with MSG_TRUNC only the
+        // part that fit in the slot is valid. Callers only consume frames
+        // of the expected size, which always fit.
+        out->payload = slot + payload_off;
+        out->payload_len = hdr->payloadlen;
+        ur->delivered = true;
+        ur->held++;
+        return URING_POLL_FRAME;
+    }
+}
+
+void uring_receiver_release(UringReceiver *ur, int slot) {
+    if (slot >= 0 && slot < URING_RING_ENTRIES) {
+        recycle_slot(ur, (unsigned short)slot);
+        ur->held--;
+    }
+}
+
+void uring_receiver_close(UringReceiver *ur) {
+    if (ur->ring_fd >= 0) {
+        close(ur->ring_fd);
+        ur->ring_fd = -1;
+    }
+    if (ur->sqes) {
+        munmap(ur->sqes, ur->sqes_len);
+    }
+    if (ur->cq_ptr && ur->cq_ptr != ur->sq_ptr) {
+        munmap(ur->cq_ptr, ur->cq_len);
+    }
+    if (ur->sq_ptr) {
+        munmap(ur->sq_ptr, ur->sq_len);
+    }
+    if (ur->buf_ring) {
+        munmap(ur->buf_ring, ur->buf_ring_len);
+    }
+    ur->sqes = NULL;
+    ur->cq_ptr = NULL;
+    ur->sq_ptr = NULL;
+    ur->buf_ring = NULL;
+    ur->armed = false;
+}
+
+#else // no io_uring headers with multishot recv and provided buffer rings
+
+bool uring_receiver_init(UringReceiver *ur, int sock, size_t control_len) {
+    (void)control_len;
+    memset(ur, 0, sizeof(*ur));
+    ur->ring_fd = -1;
+    ur->sock = sock;
+    fprintf(stderr, "io_uring: not available in this build\n");
+    return false;
+}
+
+UringPollResult uring_receiver_poll(UringReceiver *ur, UringCompletion *out) {
+    (void)ur;
+    (void)out;
+    return URING_POLL_FAILED;
+}
+
+void uring_receiver_release(UringReceiver *ur, int slot) {
+    (void)ur;
+    (void)slot;
+}
+
+void uring_receiver_close(UringReceiver *ur) {
+    (void)ur;
+}
+
+#endif
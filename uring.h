@@ -0,0 +1,80 @@
+/*
+
+Copyright 2025 Marc Ketel
+SPDX-License-Identifier: Apache-2.0
+
+*/
+
+#ifndef URING_H
+#define URING_H
+
+#include <netinet/in.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/socket.h>
+
+// Provided buffer ring: one slot per datagram. Multishot recvmsg puts a
+// struct io_uring_recvmsg_out, the source address and the payload in each.
+#define URING_RING_ENTRIES 64
+#define URING_SLOT_SIZE    2304
+#define URING_CQ_ENTRIES   (URING_RING_ENTRIES * 2) // a completion for every slot, and then some
+
+typedef enum UringPollResult {
+    URING_POLL_EMPTY,  // nothing completed yet
+    URING_POLL_FRAME,  // out is set, its slot must be released after use
+    URING_POLL_FAILED, // ring unusable on this kernel, caller should fall back
+} UringPollResult;
+
+// One completed datagram, pointing into its buffer slot.
+typedef struct UringCompletion {
+    int slot; // must be released with uring_receiver_release()
+    const unsigned char *payload;
+    size_t payload_len; // full datagram length, see uring_receiver_poll()
+    const void *name;   // source address as filled in by the kernel
+    size_t name_len;
+    void *control; // ancillary data (cmsg), control_len bytes
+    size_t control_len;
+} UringCompletion;
+
+typedef struct UringReceiver {
+    int ring_fd;
+    int sock;
+
+    // Submission and completion queues, mapped from the kernel.
+    void *sq_ptr;
+    size_t sq_len;
+    void *cq_ptr;
+    size_t cq_len;
+    struct io_uring_sqe *sqes;
+    size_t sqes_len;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned *sq_flags;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+
+    // Provided buffer ring and the slots it hands out.
+    struct io_uring_buf_ring *buf_ring;
+    size_t buf_ring_len;
+    unsigned char *slots;
+    unsigned short buf_tail;
+    int held; // slots handed out and not released yet
+
+    struct msghdr msg; // layout template for multishot recvmsg, must outlive the request
+    bool armed;        // a multishot recvmsg is in flight
+    bool delivered;    // at least one datagram completed successfully
+    unsigned long syscalls;
+} UringReceiver;
+
+// control_len reserves room for ancillary data (e.g. receive timestamps)
+// in every slot, next to the source address.
+bool uring_receiver_init(UringReceiver *ur, int sock, size_t control_len);
+UringPollResult uring_receiver_poll(UringReceiver *ur, UringCompletion *out);
+void uring_receiver_release(UringReceiver *ur, int slot);
+void uring_receiver_close(UringReceiver *ur);
+
+#endif // URING_H
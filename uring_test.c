@@ -0,0 +1,154 @@
+/*
+
+Copyright 2025 Marc Ketel
+SPDX-License-Identifier: Apache-2.0
+
+*/
+
+/*
+ * Checks for the io_uring receive backend over loopback UDP, no SDL:
+ *
+ *   make test
+ *
+ * Floods the socket before the first poll, more datagrams than the CQ of
+ * a small ring holds and more than there are buffer slots, and expects
+ * every datagram to come out, in order, with the receiver still armed
+ * afterwards. Exits 0 without testing when io_uring is not available.
+ */
+
+#include "uring.h"
+
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define FLOOD_SMALL (URING_RING_ENTRIES / 2)     // more than an 8-entry ring's CQ
+#define FLOOD_LARGE (URING_RING_ENTRIES * 3 / 2) // more than there are buffer slots
+
+static int failures;
+
+#define CHECK(cond, ...)                                  \
+    do {                                                  \
+        if (!(cond)) {                                    \
+            fprintf(stderr, "%s:%d: ", __FILE__, __LINE__); \
+            fprintf(stderr, __VA_ARGS__);                 \
+            fprintf(stderr, "\n");                        \
+            failures++;                                   \
+        }                                                 \
+    } while (0)
+
+static void send_flood(int tx, const struct sockaddr_in *to, unsigned first, int count) {
+    for (int i = 0; i < count; ++i) {
+        unsigned seq = first + (unsigned)i;
+        if (sendto(tx, &seq, sizeof(seq), 0, (const struct sockaddr *)to, sizeof(*to)) != sizeof(seq)) {
+            perror("sendto");
+        }
+    }
+}
+
+// Polls until count datagrams came out or polls stay empty for ~100 ms.
+// With held set, slots are kept there instead of released, and polling
+// stops once all of them are taken.
+static int drain(UringReceiver *ur, unsigned first, int count, int *held) {
+    int got = 0;
+    int idle = 0;
+    while (got < count && idle < 100) {
+        UringCompletion c;
+        UringPollResult res = uring_receiver_poll(ur, &c);
+        if (res == URING_POLL_FAILED) {
+            CHECK(false, "poll failed");
+            break;
+        }
+        if (res == URING_POLL_EMPTY) {
+            if (held && got == URING_RING_ENTRIES) {
+                break;
+            }
+            idle++;
+            usleep(1000);
+            continue;
+        }
+        idle = 0;
+        unsigned seq = 0;
+        CHECK(c.payload_len == sizeof(seq), "datagram %d: %zu bytes", got, c.payload_len);
+        memcpy(&seq, c.payload, sizeof(seq));
+        CHECK(seq == first + (unsigned)got, "datagram %d: sequence %u, expected %u", got, seq, first + (unsigned)got);
+        if (held) {
+            held[got] = c.slot;
+        } else {
+            uring_receiver_release(ur, c.slot);
+        }
+        got++;
+    }
+    return got;
+}
+
+int main(void) {
+    int rx = socket(AF_INET, SOCK_DGRAM, 0);
+    int tx = socket(AF_INET, SOCK_DGRAM, 0);
+    int rcvbuf = 1 << 20;
+    setsockopt(rx, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addr_len = sizeof(addr);
+    if (bind(rx, (struct sockaddr *)&addr, sizeof(addr)) < 0 || getsockname(rx, (struct sockaddr *)&addr, &addr_len) < 0) {
+        perror("bind");
+        return 1;
+    }
+
+    UringReceiver ur;
+    if (!uring_receiver_init(&ur, rx, 0)) {
+        printf("io_uring not available, skipped\n");
+        return 0;
+    }
+
+    // A burst before the first poll, released as it goes.
+    send_flood(tx, &addr, 0, FLOOD_SMALL);
+    usleep(20000);
+    int got = drain(&ur, 0, FLOOD_SMALL, NULL);
+    CHECK(got == FLOOD_SMALL, "burst: %d of %d datagrams", got, FLOOD_SMALL);
+
+    // More than the ring has slots, all held: the request runs out of
+    // buffers, the rest waits in the socket until slots come back.
+    unsigned first = FLOOD_SMALL;
+    send_flood(tx, &addr, first, FLOOD_LARGE);
+    usleep(20000);
+    int held[URING_RING_ENTRIES];
+    got = drain(&ur, first, FLOOD_LARGE, held);
+    CHECK(got == URING_RING_ENTRIES, "held flood: %d datagrams before running out, expected %d", got, URING_RING_ENTRIES);
+    unsigned long syscalls = ur.syscalls;
+    UringCompletion c;
+    for (int i = 0; i < 10; ++i) {
+        uring_receiver_poll(&ur, &c);
+    }
+    CHECK(ur.syscalls == syscalls, "out of buffers: %lu syscalls while no slot was free", ur.syscalls - syscalls);
+
+    for (int i = 0; i < got; ++i) {
+        uring_receiver_release(&ur, held[i]);
+    }
+
+    // With slots back the receiver re-arms and picks up the rest.
+    first += (unsigned)got;
+    got = drain(&ur, first, FLOOD_LARGE - got, NULL);
+    CHECK(got == FLOOD_LARGE - URING_RING_ENTRIES, "after release: %d of %d datagrams", got, FLOOD_LARGE - URING_RING_ENTRIES);
+
+    // And keeps receiving.
+    first += (unsigned)got;
+    send_flood(tx, &addr, first, 4);
+    got = drain(&ur, first, 4, NULL);
+    CHECK(got == 4, "still receiving: %d of 4 datagrams", got);
+
+    uring_receiver_close(&ur);
+    close(rx);
+    close(tx);
+
+    if (failures) {
+        printf("uring_test: %d failures\n", failures);
+        return 1;
+    }
+    printf("uring_test: ok\n");
+    return 0;
+}